@@ -0,0 +1,41 @@
+#pragma once
+#include <filesystem>
+#include <string>
+
+#include "../io/mapped_file.hpp"
+#include "cartridge.hpp"
+
+namespace bemu::gb {
+/// Keeps the RAM of a battery-backed cartridge in a save file, as the battery keeps it in a real cartridge
+///
+/// The file is mapped into memory. On construction, the save in the file is loaded into the cartridge RAM, or the
+/// file is created if there is none. flush() copies the pages the game wrote since the last flush (see
+/// Cartridge::get_ram_dirty_pages()) into the mapping, and starts writing them back to disk without waiting. Writes
+/// to RAM only set a bit, and a flush without writes only scans the bitmap, so flushing every frame is cheap.
+///
+/// Once copied, the data is in the OS file cache, so it survives the emulator crashing.
+///
+/// The cartridge keeps its own RAM rather than using the mapping directly, so clones (see Cartridge::clone()) never
+/// write to the file.
+struct BatterySave {
+    /// Throws std::runtime_error if the file cannot be opened or mapped
+    BatterySave(Cartridge& cartridge, const std::string& filename);
+
+    /// Flushes the pending writes
+    ~BatterySave();
+
+    BatterySave(const BatterySave&) = delete;
+    BatterySave& operator=(const BatterySave&) = delete;
+
+    void flush();
+
+   private:
+    Cartridge& m_cartridge;
+    MappedFile m_file;
+};
+
+/// The save file of a ROM: the same name, with the extension .sav
+inline std::filesystem::path get_battery_save_path(const std::filesystem::path& rom_filename) {
+    return std::filesystem::path{rom_filename}.replace_extension(".sav");
+}
+}  // namespace bemu::gb
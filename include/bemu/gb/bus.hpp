@@ -1,8 +1,10 @@
 #pragma once
+#include <span>
 
 #include "interfaces.hpp"
 #include "joypad.hpp"
 #include "lcd.hpp"
+#include "machine_state.hpp"
 #include "memory.hpp"
 #include "ppu.hpp"
 #include "ram.hpp"
@@ -42,7 +44,18 @@ struct Bus : MemoryBus {
     NoopRegion<0xE000, 0xFDFF> m_reserved_echo;    // Reserved - Echo RAM
     NoopRegion<0xFEA0, 0xFEFF> m_reserved_unused;  // Reserved - Unusable
 
-    explicit Bus(ICycler &cycler, Cpu &cpu, Cartridge &cartridge, External &external);
+    /// Writes to the RAM regions in state are marked in dirty_pages, see Emulator::m_dirty_pages
+    Bus(MachineState &state, DirtyPages &dirty_pages, ICycler &cycler, Cpu &cpu, Cartridge &cartridge,
+        External &external);
+
+    /// Host memory from address to the end of the bank or RAM it is in, for DMA transfers to read directly. Empty where
+    /// reads must go through the memory map, e.g. cartridge banks handled by the mapper, I/O registers, or VRAM, which
+    /// the PPU locks while drawing.
+    [[nodiscard]] std::span<const u8> find_memory(u16 address);
+
+    /// The static memory map of the bus (see MemoryBus::StaticMap), which must behave as the memory map it replaces
+    [[nodiscard]] static u8 read_static(const MemoryBus &bus, u16 address);
+    static void write_static(MemoryBus &bus, u16 address, u8 value);
 
     void serialize(auto &ar) {
         m_lcd.serialize(ar);
@@ -57,5 +70,29 @@ struct Bus : MemoryBus {
         m_serial.serialize(ar);
         m_serial.serialize(ar);
     }
+
+    /// Same as serialize(), except for the PPU, so it can be saved separately (see Emulator::serialize_section())
+    void serialize_without_ppu(auto &ar) {
+        m_lcd.serialize(ar);
+        m_joypad.serialize(ar);
+        m_timer.serialize(ar);
+        m_wram_fixed.serialize(ar);
+        m_wram.serialize(ar);
+        m_hram.serialize(ar);
+        m_audio.serialize(ar);
+        m_wave_pattern.serialize(ar);
+        m_serial.serialize(ar);
+    }
+
+   private:
+    /// Call access(region) with the region handling address
+    ///
+    /// These are the regions added to the memory map, with the same precedence, but known at compile time: accesses
+    /// switch on the address and call the regions directly, instead of searching the map through virtual calls.
+    template <typename TBus, typename TAccess>
+    static decltype(auto) dispatch(TBus &bus, u16 address, TAccess &&access);
+
+    Cpu &m_cpu;
+    Cartridge &m_cartridge;
 };
 }  // namespace bemu::gb
\ No newline at end of file
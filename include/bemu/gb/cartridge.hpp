@@ -1,6 +1,9 @@
 #pragma once
 #include <memory>
+#include <span>
 #include <string>
+#include <type_traits>
+#include <variant>
 #include <vector>
 
 #include "cartridge_header.hpp"
@@ -11,37 +14,85 @@
 #include "ram.hpp"
 
 namespace bemu::gb {
-struct IMapper;
+/// All mappers, dispatched with std::visit, so calls to them can be inlined
+using Mapper = std::variant<MBC0, MBC1_0, MBC3, MBC5>;
 
-struct Cartridge : IMemoryRegion {
+struct Cartridge final : IMemoryRegion {
+    /// Cartridge running rom, which rom_owner keeps alive
+    Cartridge(std::span<const u8> rom, std::shared_ptr<const void> rom_owner);
     ~Cartridge() override;
 
+    Cartridge& operator=(const Cartridge&) = delete;
+
     static std::unique_ptr<Cartridge> from_file(const std::string& filename);
     static std::unique_ptr<Cartridge> from_program_code(const std::vector<u8>& data);
 
+    /// Create an independent copy of this cartridge, including the mapper state and RAM. The ROM is shared.
+    [[nodiscard]] std::unique_ptr<Cartridge> clone() const;
+
     [[nodiscard]] const CartridgeHeader& header() const;
 
+    /// Whether a battery keeps the RAM contents while the Game Boy is off, so they should be saved (see BatterySave)
+    [[nodiscard]] bool has_battery() const;
+
+    /// External RAM, empty if the cartridge has none. Writing to it directly does not mark pages dirty.
+    [[nodiscard]] std::span<u8> get_ram();
+
+    /// Pages of get_ram() written by the game since they were last cleared
+    [[nodiscard]] DirtyPages& get_ram_dirty_pages();
+
+    /// Banks currently mapped by the mapper, see MappedBanks
+    [[nodiscard]] const MappedBanks& get_banks() const;
+
+    /// Source of emulated time, for mappers with a clock
+    void connect(const ICycler& clock);
+
+    /// Whether both cartridges share the same ROM image, i.e. one is a clone of the other, or both were loaded from
+    /// the same file
+    [[nodiscard]] bool shares_rom_with(const Cartridge& other) const { return m_rom.data() == other.m_rom.data(); }
+
     [[nodiscard]] bool contains(u16 address) const override;
     [[nodiscard]] u8 read(u16 address) const override;
     void write(u16 address, u8 value) override;
 
-    static std::unique_ptr<IMapper> make_mapper(const CartridgeHeader& header, std::vector<u8>& data);
+    static Mapper make_mapper(const CartridgeHeader& header, std::span<const u8> data);
 
     void serialize(auto& ar) {
-        if (auto mapper = dynamic_cast<MBC0*>(m_mapper.get())) {
-            mapper->serialize(ar);
-        } else if (auto mapper = dynamic_cast<MBC1_0*>(m_mapper.get())) {
-            mapper->serialize(ar);
-        } else if (auto mapper = dynamic_cast<MBC3*>(m_mapper.get())) {
-            mapper->serialize(ar);
-        } else if (auto mapper = dynamic_cast<MBC5*>(m_mapper.get())) {
-            mapper->serialize(ar);
-        }
+        std::visit(
+            [&](auto& mapper) {
+                mapper.serialize(ar);
+                if constexpr (std::remove_reference_t<decltype(ar)>::is_loading) {
+                    mapper.update_banks();
+                }
+            },
+            m_mapper);
+    }
+
+    /// State of the mapper's clock, if it has one
+    void serialize_rtc(auto& ar) {
+        std::visit(
+            [&](auto& mapper) {
+                if constexpr (requires { mapper.serialize_rtc(ar); }) {
+                    mapper.serialize_rtc(ar);
+                }
+            },
+            m_mapper);
     }
 
    private:
-    std::unique_ptr<std::vector<u8>> m_data = std::make_unique<std::vector<u8>>();
-    std::unique_ptr<IMapper> m_mapper;
+    /// Copy the mapper state and RAM, see clone()
+    Cartridge(const Cartridge& other);
+
+    /// Point the banks of the mapper at its own RAM, after it was moved or copied
+    void update_banks();
+
+    [[nodiscard]] BaseMapper& get_base_mapper();
+    [[nodiscard]] const BaseMapper& get_base_mapper() const;
+
+    /// ROM contents. Immutable, so clones, and cartridges loaded from the same file, share it.
+    std::span<const u8> m_rom;
+    std::shared_ptr<const void> m_rom_owner;  ///< Keeps m_rom alive: the mapped file, or the vector of program code
+    Mapper m_mapper;
 };
 
 }  // namespace bemu::gb
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <chrono>
 #include <optional>
 #include <thread>
@@ -7,33 +8,119 @@
 #include "screen.hpp"
 
 namespace bemu::gb {
+/// Result of waiting for the next emulated interval
+enum class FrameStatus : u8 {
+    OnTime,    ///< Deadline was in the future, and we waited for it
+    Late,      ///< Deadline already passed, but within the catch-up budget. Caller may skip rendering to catch up.
+    Resynced,  ///< Too far behind to catch up. The timeline was re-anchored to now, and the debt dropped.
+};
+
+/// Frame pacing statistics, for display and debugging
+struct PacingStats {
+    u64 m_frames = 0;       ///< Number of intervals paced
+    u64 m_late_frames = 0;  ///< Number of intervals where the deadline had already passed
+    u64 m_resyncs = 0;      ///< Number of times the timeline was re-anchored because we fell too far behind
+    std::chrono::nanoseconds m_worst_lateness{0};  ///< Largest observed lateness
+};
+
 /// Helper for timing emulation to real time
+///
+/// The clock keeps an absolute timeline: an anchor time point plus the (speed scaled) number of emulated ticks since
+/// the anchor. Each deadline is computed from the anchor, not from the previous wake-up, so oversleeping one frame does
+/// not delay the following ones and the average rate stays at exactly 4194304 / 70224 Hz.
+///
+/// Waiting is done with a coarse sleep_until() up to a short margin before the deadline, followed by a spin for the
+/// remainder, which gives sub-millisecond wake-up jitter.
+///
+/// If we fall behind, the following intervals report FrameStatus::Late without sleeping, letting the caller catch up.
+/// When the debt exceeds m_max_catch_up_frames, the timeline is re-anchored instead.
 struct Clock {
-    constexpr static double frame_rate = 59.7275;
+    using clock_type = std::chrono::steady_clock;
 
-    void sleep_frame(const std::optional<double> speedup_factor = std::nullopt) {
-        sleep(1.0 / frame_rate, speedup_factor);
+    constexpr static double ticks_per_second = 4194304.0;
+    constexpr static u64 ticks_per_frame = 70224;
+    constexpr static u64 ticks_per_scanline = 456;
+    constexpr static double frame_rate = ticks_per_second / ticks_per_frame;  ///< 59.7275 Hz
+
+    FrameStatus sleep_frame(const std::optional<double> speedup_factor = std::nullopt) {
+        return sleep_ticks(ticks_per_frame, speedup_factor);
     }
 
-    void sleep_scanline(const std::optional<double> speedup_factor = std::nullopt) {
-        sleep(1.0 / frame_rate / screen_height, speedup_factor);
+    FrameStatus sleep_scanline(const std::optional<double> speedup_factor = std::nullopt) {
+        return sleep_ticks(ticks_per_scanline, speedup_factor);
     }
 
-    void sleep(const double target_interval, const std::optional<double> speedup_factor = std::nullopt) {
-        if (m_then) {
-            const auto target_duration =
-                std::chrono::duration<double>(target_interval / m_speedup_factor / speedup_factor.value_or(1.0));
-            const auto target_time = *m_then + target_duration;
-            m_then = std::chrono::high_resolution_clock::now();
-            std::this_thread::sleep_until(target_time);
-        } else {
-            m_then = std::chrono::high_resolution_clock::now();
+    /// Advance the timeline by the given number of emulated ticks, and wait until real time catches up
+    FrameStatus sleep_ticks(const u64 ticks, const std::optional<double> speedup_factor = std::nullopt) {
+        const auto now = clock_type::now();
+        if (!m_anchor) {
+            reset(now);
+            return FrameStatus::OnTime;
         }
+
+        const double speedup = m_speedup_factor * speedup_factor.value_or(1.0);
+        m_scaled_ticks += static_cast<double>(ticks) / speedup;
+        ++m_stats.m_frames;
+
+        const auto deadline = *m_anchor + to_duration(m_scaled_ticks);
+        if (deadline >= now) {
+            wait_until(deadline);
+            return FrameStatus::OnTime;
+        }
+
+        const auto lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline);
+        ++m_stats.m_late_frames;
+        m_stats.m_worst_lateness = std::max(m_stats.m_worst_lateness, lateness);
+
+        // Too far behind, e.g. after the process was suspended. Racing to catch up would only cause a burst of frames.
+        if (lateness > to_duration(m_max_catch_up_frames * ticks_per_frame / speedup)) {
+            ++m_stats.m_resyncs;
+            reset(now);
+            return FrameStatus::Resynced;
+        }
+
+        return FrameStatus::Late;
+    }
+
+    /// Re-anchor the timeline at the given time point, e.g. after pausing
+    void reset(const clock_type::time_point now = clock_type::now()) {
+        m_anchor = now;
+        m_scaled_ticks = 0.0;
     }
 
+    [[nodiscard]] const PacingStats& get_stats() const { return m_stats; }
+
     double m_speedup_factor = 1.0;
 
+    /// Maximum number of frames we are allowed to be behind before giving up and re-anchoring
+    double m_max_catch_up_frames = 4.0;
+
+    /// Time before each deadline where we stop sleeping and start spinning. Should cover the scheduler's wake-up
+    /// jitter.
+    std::chrono::microseconds m_spin_margin{1500};
+
    private:
-    std::optional<std::chrono::high_resolution_clock::time_point> m_then;
+    static clock_type::duration to_duration(const double ticks) {
+        return std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::duration<double>(ticks / ticks_per_second));
+    }
+
+    void wait_until(const clock_type::time_point deadline) const {
+        if (deadline - clock_type::now() > m_spin_margin) {
+            std::this_thread::sleep_until(deadline - m_spin_margin);
+        }
+
+        while (clock_type::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+    /// Real time corresponding to m_scaled_ticks == 0
+    std::optional<clock_type::time_point> m_anchor;
+
+    /// Emulated ticks since the anchor, divided by the speedup factor in effect when they were added
+    double m_scaled_ticks = 0.0;
+
+    PacingStats m_stats;
 };
 }  // namespace bemu::gb
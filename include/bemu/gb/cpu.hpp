@@ -90,54 +90,8 @@ struct CpuRegisters {
     }
 };
 
-struct External;
-struct Lcd;
-struct MemoryBus;
-struct Timer;
-
-/// Sharp Z80 CPU
-struct Cpu : IMemoryRegion {
-    Cpu();
-
-    void connect(ICycler *cycler, MemoryBus *memory);
-
-    void add_cycle();
-
-    // IMemoryRegion
-    [[nodiscard]] bool contains(u16 address) const override;
-    [[nodiscard]] u8 read(u16 address) const override;
-    void write(u16 address, u8 value) override;
-
-    void set_pending_interrupt(InterruptType type, bool pending_interrupt = true);
-    [[nodiscard]] bool has_pending_interrupt() const;
-
-    [[nodiscard]] u8 peek_u8() const;    ///< Fetch u8 from program counter
-    [[nodiscard]] u16 peek_u16() const;  ///< Fetch u16 from program counter, little-endian
-    [[nodiscard]] u8 fetch_u8();         ///< Fetch u8 from program counter
-    [[nodiscard]] u16 fetch_u16();       ///< Fetch u16 from program counter, little-endian
-
-    void stack_push8(u8 value);
-    u8 stack_pop8();
-    void stack_push16(u16 value);
-    u16 stack_pop16();
-
-    /// Execute a single CPU instruction
-    ///
-    /// If halted, adds 1 cycle and returns.
-    bool step();
-    void execute_next_instruction();
-    void execute_interrupts();
-
-    void serialize(auto &ar) {
-        m_registers.serialize(ar);
-        ar(m_halted);
-        ar(m_stepping);
-        ar(m_interrupt_master_enable);
-        ar(m_set_interrupt_master_enable_next_cycle);
-        ar(m_interrupt_request_flags);
-        ar(m_interrupt_enable_flags);
-    }
-
+/// Mutable CPU state, stored in MachineState
+struct CpuState {
     CpuRegisters m_registers;
 
     bool m_halted = false;
@@ -183,6 +137,60 @@ struct Cpu : IMemoryRegion {
     /// FFFF — IE: Interrupt enable
     u8 m_interrupt_enable_flags = 0;
 
+    void serialize(auto &ar) {
+        m_registers.serialize(ar);
+        ar(m_halted);
+        ar(m_stepping);
+        ar(m_interrupt_master_enable);
+        ar(m_set_interrupt_master_enable_next_cycle);
+        ar(m_interrupt_request_flags);
+        ar(m_interrupt_enable_flags);
+    }
+};
+
+struct External;
+struct Lcd;
+struct MemoryBus;
+struct Timer;
+
+/// Sharp Z80 CPU
+struct Cpu final : IMemoryRegion {
+    explicit Cpu(CpuState &state);
+
+    void connect(ICycler *cycler, MemoryBus *memory);
+
+    void add_cycle();
+
+    // IMemoryRegion
+    [[nodiscard]] bool contains(u16 address) const override;
+    [[nodiscard]] u8 read(u16 address) const override;
+    void write(u16 address, u8 value) override;
+
+    void set_pending_interrupt(InterruptType type, bool pending_interrupt = true);
+    [[nodiscard]] bool has_pending_interrupt() const;
+
+    [[nodiscard]] u8 peek_u8() const;    ///< Fetch u8 from program counter
+    [[nodiscard]] u16 peek_u16() const;  ///< Fetch u16 from program counter, little-endian
+    [[nodiscard]] u8 fetch_u8();         ///< Fetch u8 from program counter
+    [[nodiscard]] u16 fetch_u16();       ///< Fetch u16 from program counter, little-endian
+
+    void stack_push8(u8 value);
+    u8 stack_pop8();
+    void stack_push16(u16 value);
+    u16 stack_pop16();
+
+    /// Execute a single CPU instruction
+    ///
+    /// If halted, adds 1 cycle and returns.
+    bool step();
+    void execute_next_instruction();
+    void execute_interrupts();
+
+    void serialize(auto &ar) { m_state.serialize(ar); }
+
+    CpuState &m_state;
+    CpuRegisters &m_registers;  ///< Same as m_state.m_registers
+
     // Pointers back to memory and cycler.
     // Both cycler and memory own CPU, so raw pointers are fine.
     //
@@ -31,7 +31,7 @@ inline void jp_HL(Cpu &cpu) {
 template <Condition Cond, bool enable_interrupt = false>
 void ret(Cpu &cpu) {
     if constexpr (enable_interrupt) {
-        cpu.m_interrupt_master_enable = true;
+        cpu.m_state.m_interrupt_master_enable = true;
     }
 
     if constexpr (Cond != Condition::NoCondition) {
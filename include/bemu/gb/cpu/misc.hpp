@@ -7,7 +7,7 @@ inline void nop(Cpu &) {}
 
 inline void stop(Cpu &) { throw std::runtime_error("Stopped"); }
 
-inline void halt(Cpu &cpu) { cpu.m_halted = true; }
+inline void halt(Cpu &cpu) { cpu.m_state.m_halted = true; }
 
 inline void rlca(Cpu &cpu) {
     auto value = cpu.m_registers.a;
@@ -94,8 +94,8 @@ inline void daa(Cpu &cpu) {
     reg.set_h(false);
 }
 
-inline void di(Cpu &cpu) { cpu.m_interrupt_master_enable = false; }
+inline void di(Cpu &cpu) { cpu.m_state.m_interrupt_master_enable = false; }
 
-inline void ei(Cpu &cpu) { cpu.m_set_interrupt_master_enable_next_cycle = true; }
+inline void ei(Cpu &cpu) { cpu.m_state.m_set_interrupt_master_enable_next_cycle = true; }
 
 }  // namespace bemu::gb::cpu
\ No newline at end of file
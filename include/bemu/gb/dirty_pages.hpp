@@ -0,0 +1,90 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#include "../types.hpp"
+
+namespace bemu::gb {
+/// Pages of a block of memory which may have changed since the last clear()
+///
+/// Memory regions register the bytes they own with track(), and mark() every byte they write. Pages which are not
+/// entirely covered by tracked regions are always reported as dirty, so state which changes without going through a
+/// tracked write (registers, counters) is never missed.
+///
+/// Offsets are relative to the start of the block, so the bitmap stays valid when the block is copied.
+struct DirtyPages {
+    static constexpr size_t page_size = 64;
+
+    DirtyPages() = default;
+    explicit DirtyPages(const size_t size)
+        : m_size(size), m_dirty(get_num_words(), ~u64{0}), m_untracked(get_num_words(), ~u64{0}) {}
+
+    [[nodiscard]] size_t get_num_pages() const { return (m_size + page_size - 1) / page_size; }
+
+    /// Only report the pages entirely within [offset, offset + size) as dirty after they are marked
+    void track(const size_t offset, const size_t size) {
+        const auto first = (offset + page_size - 1) / page_size;
+        const auto last = std::min(offset + size, m_size) / page_size;
+        for (auto page = first; page < last; ++page) {
+            m_untracked[page / 64] &= ~(u64{1} << (page % 64));
+        }
+    }
+
+    void mark(const size_t offset) {
+        const auto page = offset / page_size;
+        m_dirty[page / 64] |= u64{1} << (page % 64);
+    }
+
+    /// Also mark the pages dirty in other, which must track a block of the same size
+    void mark(const DirtyPages& other) {
+        for (size_t i = 0; i < m_dirty.size(); ++i) {
+            m_dirty[i] |= other.m_dirty[i];
+        }
+    }
+
+    /// Everything changed, e.g. because a save state was loaded
+    void mark_all() { std::ranges::fill(m_dirty, ~u64{0}); }
+
+    void clear() { std::ranges::copy(m_untracked, m_dirty.begin()); }
+
+    [[nodiscard]] bool is_dirty(const size_t offset) const {
+        const auto page = offset / page_size;
+        return (m_dirty[page / 64] >> (page % 64) & 1) != 0;
+    }
+
+    /// Call f(offset, size) for each run of consecutive dirty pages, in order
+    void for_each_dirty_range(auto&& f) const {
+        const auto num_pages = get_num_pages();
+        auto page = find_page(0, true);
+        while (page < num_pages) {
+            const auto end = find_page(page, false);
+            f(page * page_size, std::min(end * page_size, m_size) - page * page_size);
+            page = find_page(end, true);
+        }
+    }
+
+   private:
+    [[nodiscard]] size_t get_num_words() const { return (get_num_pages() + 63) / 64; }
+
+    /// First page at or after page whose dirty bit equals dirty, or get_num_pages()
+    [[nodiscard]] size_t find_page(size_t page, const bool dirty) const {
+        const auto num_pages = get_num_pages();
+        while (page < num_pages) {
+            auto word = m_dirty[page / 64];
+            if (!dirty) word = ~word;
+            word >>= page % 64;
+
+            if (word != 0) {
+                return std::min(page + std::countr_zero(word), num_pages);
+            }
+            page = (page / 64 + 1) * 64;
+        }
+        return num_pages;
+    }
+
+    size_t m_size = 0;
+    std::vector<u64> m_dirty;
+    std::vector<u64> m_untracked;  ///< Pages not covered by track(), which are always dirty
+};
+}  // namespace bemu::gb
@@ -1,22 +1,51 @@
 #pragma once
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <type_traits>
 
 #include "../emulator.hpp"
 #include "bus.hpp"
 #include "cartridge.hpp"
 #include "cpu.hpp"
+#include "dirty_pages.hpp"
 #include "external.hpp"
 #include "interfaces.hpp"
+#include "machine_state.hpp"
 
 namespace bemu::gb {
 
 struct Cartridge;
 
+/// Independent parts of the emulator state, see Emulator::serialize_section(). The values are stored in save state
+/// files, so they must not change.
+enum class StateSection : u32 {
+    Emulator = 1,  ///< Run state, tick and frame counters, received serial data
+    Cpu = 2,
+    Bus = 3,  ///< Memory and I/O registers, except the PPU
+    Ppu = 4,
+    Cartridge = 5,
+    Screen = 6,
+    Rtc = 7,  ///< Clock of the cartridge mapper, if it has one. Since version 2 of the file format.
+};
+
+constexpr StateSection state_sections[] = {
+    StateSection::Emulator,  StateSection::Cpu,    StateSection::Bus, StateSection::Ppu,
+    StateSection::Cartridge, StateSection::Screen, StateSection::Rtc,
+};
+
 struct Emulator : IEmulator, ICycler {
     explicit Emulator(std::unique_ptr<Cartridge> cartridge);
 
+    /// Create an independent copy of this emulator. The ROM is shared, everything else is copied.
+    [[nodiscard]] std::unique_ptr<Emulator> clone();
+
+    /// Copy the whole state of this emulator into target, which must have been cloned from this emulator (or share
+    /// its ROM otherwise). Much cheaper than clone(), since nothing is allocated; use this to fork repeatedly into a
+    /// pool of emulators.
+    void clone_into(Emulator &target);
+
     size_t get_tick_count() const override { return m_external->m_ticks; }
     Screen &get_screen() override { return m_external->m_screen; }
     const Screen &get_screen() const override { return m_external->m_screen; }
@@ -32,19 +61,85 @@ struct Emulator : IEmulator, ICycler {
     bool run_to_next_frame();
     bool run_to_next_scan_line();
 
-    void serialize(auto &ar) {
+    void serialize(auto &ar) { serialize_stream(ar, true); }
+
+    /// Same as serialize(), but without the clock of the cartridge mapper, as written before it was saved: the stream
+    /// of version 0 save state files (see StateSection::Rtc)
+    void serialize_without_rtc(auto &ar) { serialize_stream(ar, false); }
+
+    /// Same state as serialize(), but with MachineState as one raw block, which is much faster. Only for in-memory
+    /// snapshots: the layout depends on the build, so it must not be written to files.
+    void serialize_snapshot(auto &ar) {
+        if constexpr (std::remove_reference_t<decltype(ar)>::is_loading) {
+            m_dirty_pages.mark_all();
+            m_bus.m_ppu.m_oam_dma.reset_source();
+        }
+
         ar(m_running);
-        m_cpu.serialize(ar);
-        m_bus.serialize(ar);
+        ar(m_state.bytes());
         m_cartridge->serialize(ar);
+        m_cartridge->serialize_rtc(ar);
         m_external->serialize(ar);
     }
 
+    /// One section of the state. Together, state_sections hold the same state as serialize().
+    void serialize_section(const StateSection section, auto &ar) {
+        if constexpr (std::remove_reference_t<decltype(ar)>::is_loading) {
+            m_dirty_pages.mark_all();
+            m_bus.m_ppu.m_oam_dma.reset_source();
+        }
+
+        switch (section) {
+            case StateSection::Emulator:
+                ar(m_running);
+                m_external->serialize_without_screen(ar);
+                break;
+            case StateSection::Cpu: m_cpu.serialize(ar); break;
+            case StateSection::Bus: m_bus.serialize_without_ppu(ar); break;
+            case StateSection::Ppu: m_bus.m_ppu.serialize(ar); break;
+            case StateSection::Cartridge: m_cartridge->serialize(ar); break;
+            case StateSection::Screen: m_external->m_screen.serialize(ar); break;
+            case StateSection::Rtc: m_cartridge->serialize_rtc(ar); break;
+        }
+    }
+
+    /// Call f(offset, size) for the ranges of serialize_snapshot() output which may have changed since
+    /// m_dirty_pages.clear(). The last range has size SIZE_MAX: it runs to the end of the snapshot.
+    void for_each_dirty_snapshot_range(auto &&f) const {
+        constexpr auto state_offset = sizeof(m_running);
+        f(size_t{0}, state_offset);
+        m_dirty_pages.for_each_dirty_range(
+            [&](const size_t offset, const size_t size) { f(state_offset + offset, size); });
+        f(state_offset + sizeof(MachineState), SIZE_MAX);
+    }
+
     std::shared_ptr<External> m_external;
     std::unique_ptr<Cartridge> m_cartridge;
+    MachineState m_state{};  ///< Value-initialized, so padding bytes are zero and snapshots are reproducible
+
+    /// Pages of m_state written since the last clear(). Loading a state marks everything; rewind clears it whenever it
+    /// stores a full state, so its deltas only need to compare the pages written since.
+    DirtyPages m_dirty_pages{sizeof(MachineState)};
     Cpu m_cpu;
     Bus m_bus;
 
     bool m_running = true;
+
+   private:
+    void serialize_stream(auto &ar, const bool with_rtc) {
+        if constexpr (std::remove_reference_t<decltype(ar)>::is_loading) {
+            m_dirty_pages.mark_all();
+            m_bus.m_ppu.m_oam_dma.reset_source();
+        }
+
+        ar(m_running);
+        m_cpu.serialize(ar);
+        m_bus.serialize(ar);
+        m_cartridge->serialize(ar);
+        if (with_rtc) {
+            m_cartridge->serialize_rtc(ar);
+        }
+        m_external->serialize(ar);
+    }
 };
 }  // namespace bemu::gb
@@ -14,11 +14,18 @@ struct External {
     /// times.
     void set_button(Joypad::Button button, bool pushed);
 
+    /// Set the state of all buttons at once, as a bit mask where bit N is set if Joypad::Button N is pushed
+    void set_buttons(u8 pushed_mask);
+
     /// Get the buttons set by set_button(), not yet processed by the CPU, and clear them.
     std::unordered_map<Joypad::Button, bool> pop_pending_buttons();
 
     void serialize(auto &ar) {
         m_screen.serialize(ar);
+        serialize_without_screen(ar);
+    }
+
+    void serialize_without_screen(auto &ar) {
         ar(m_ticks);
         ar(m_frame_number);
         ar(m_serial_data_received);
@@ -34,6 +41,10 @@ struct External {
     /// Number of frames rendered since start of simulation
     u64 m_frame_number = 0;
 
+    /// When set, the PPU skips drawing scanlines into m_screen. Used for frames that are never displayed, e.g. when
+    /// running ahead. Emulation is unaffected, since nothing reads the screen back.
+    bool m_skip_rendering = false;
+
     /// All received serial data. For debugging.
     std::vector<u8> m_serial_data_received;
 
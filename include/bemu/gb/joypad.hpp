@@ -30,10 +30,24 @@ struct ButtonStates {
     }
 };
 
+/// Joypad register and button states, stored in MachineState
+struct JoypadState {
+    /// FF00 - P1/JOYP: Joypad
+    ///
+    /// The eight Game Boy action/direction buttons are arranged as a 2×4 matrix. Select either action or direction
+    /// buttons by writing to this register, then read out the bits 0-3.
+    ///
+    /// The lower nibble is Read-only. Note that, rather unconventionally for the Game Boy, a button being pressed is
+    /// seen as the corresponding bit being 0, not 1.
+    u8 m_joypad = 0x0;
+
+    ButtonStates m_button_states;
+};
+
 struct Cpu;
 struct External;
 
-struct Joypad : IMemoryRegion, ICycled {
+struct Joypad final : IMemoryRegion, ICycled {
     enum Button : u8 {
         BUTTON_A,
         BUTTON_B,
@@ -45,7 +59,7 @@ struct Joypad : IMemoryRegion, ICycled {
         BUTTON_RIGHT
     };
 
-    explicit Joypad(External &external, Cpu &cpu);
+    explicit Joypad(JoypadState &state, External &external, Cpu &cpu);
 
     [[nodiscard]] bool contains(u16 address) const override;
     [[nodiscard]] u8 read(u16 address) const override;
@@ -53,27 +67,18 @@ struct Joypad : IMemoryRegion, ICycled {
 
     void cycle_tick() override;
 
-    [[nodiscard]] bool get_buttons_enabled() const { return !get_bit(m_joypad, 5); }
-    [[nodiscard]] bool get_d_pad_enabled() const { return !get_bit(m_joypad, 4); }
+    [[nodiscard]] bool get_buttons_enabled() const { return !get_bit(m_state.m_joypad, 5); }
+    [[nodiscard]] bool get_d_pad_enabled() const { return !get_bit(m_state.m_joypad, 4); }
 
     void serialize(auto &ar) {
-        ar(m_joypad);
-        m_button_states.serialize(ar);
+        ar(m_state.m_joypad);
+        m_state.m_button_states.serialize(ar);
     }
 
    private:
     External &m_external;
     Cpu &m_cpu;
 
-    /// FF00 - P1/JOYP: Joypad
-    ///
-    /// The eight Game Boy action/direction buttons are arranged as a 2×4 matrix. Select either action or direction
-    /// buttons by writing to this register, then read out the bits 0-3.
-    ///
-    /// The lower nibble is Read-only. Note that, rather unconventionally for the Game Boy, a button being pressed is
-    /// seen as the corresponding bit being 0, not 1.
-    u8 m_joypad = 0x0;
-
-    ButtonStates m_button_states;
+    JoypadState &m_state;
 };
 }  // namespace bemu::gb
\ No newline at end of file
@@ -89,7 +89,9 @@ struct LcdRegisters {
 };
 #pragma pack(pop)
 
-struct Lcd : MemoryRegion<0xFF40, LcdRegisters> {
+struct Lcd final : MemoryRegion<0xFF40, LcdRegisters> {
+    using MemoryRegion::MemoryRegion;
+
     void write(u16 address, u8 value) override;
 
     /// When Bit 0 is cleared, both background and window become blank (white), and the Window Display Bit is ignored in
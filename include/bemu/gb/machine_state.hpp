@@ -0,0 +1,42 @@
+#pragma once
+#include <span>
+#include <type_traits>
+
+#include "../types.hpp"
+#include "cpu.hpp"
+#include "joypad.hpp"
+#include "lcd.hpp"
+#include "ppu.hpp"
+#include "ram.hpp"
+#include "serial.hpp"
+#include "timer.hpp"
+
+namespace bemu::gb {
+/// All mutable state of the CPU and the bus, in one contiguous block with a fixed layout
+///
+/// Components only hold references into this block, so a snapshot or restore of the machine is a single memcpy. Use
+/// offsetof() to locate a component's state within the block.
+///
+/// Not included: the cartridge (its RAM size depends on the cartridge) and External.
+struct MachineState {
+    CpuState m_cpu{};
+    LcdRegisters m_lcd{};
+    JoypadState m_joypad{};
+    PpuState m_ppu{};
+    TimerState m_timer{};
+    RAM<0xC000, 0xCFFF>::Data m_wram_fixed{};
+    WramState m_wram{};
+    RAM<0xFF80, 0xFFFE>::Data m_hram{};
+    RAM<0xFF10, 0xFF26>::Data m_audio{};
+    RAM<0xFF30, 0xFF3F>::Data m_wave_pattern{};
+    SerialRegisters m_serial{};
+
+    [[nodiscard]] std::span<u8> bytes() { return {reinterpret_cast<u8*>(this), sizeof(MachineState)}; }
+    [[nodiscard]] std::span<const u8> bytes() const {
+        return {reinterpret_cast<const u8*>(this), sizeof(MachineState)};
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<MachineState>);
+static_assert(std::is_standard_layout_v<MachineState>);
+}  // namespace bemu::gb
@@ -1,31 +1,35 @@
 #pragma once
 #include <span>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 #include "../../types.hpp"
 #include "../cartridge_header.hpp"
+#include "../dirty_pages.hpp"
+#include "../memory.hpp"
 
 namespace bemu::gb {
-struct IMapper {
-    virtual ~IMapper() = default;
-    virtual u8 read_ram(u16 address) const = 0;
-    virtual void write_ram(u16 address, u8 value) = 0;
-    virtual u8 read_rom(u16 address) const = 0;
-    virtual void write_rom(u16 address, u8 value) = 0;
-};
-
-struct BaseMapper : IMapper {
-    BaseMapper(const RomSizeType rom_size, const RamSizeType ram_size, std::vector<u8>& data)
+/// RAM and banking state common to all mappers
+///
+/// Mappers are stored by value in the Mapper variant and called through std::visit, so nothing here is virtual. Each
+/// mapper provides read_rom(), write_rom(), read_ram(), write_ram() and update_banks(), hiding those of BaseMapper
+/// where it differs.
+struct BaseMapper {
+    BaseMapper(const RomSizeType rom_size, const RamSizeType ram_size, const std::span<const u8> data)
         : m_num_rom_banks(num_rom_banks(rom_size)), m_num_ram_banks(num_ram_banks(ram_size)), m_data(data) {
         // Each RAM bank is 8KB, initialize to 0
         m_ram.resize(num_ram_banks(ram_size) * 8 * 1024, 0x00);
+        m_ram_dirty_pages = DirtyPages{m_ram.size()};
+        m_ram_dirty_pages.track(0, m_ram.size());
+        map_banks(1, true);
     }
 
-    virtual size_t ram_address_to_index(const u16 address) const {
+    size_t ram_address_to_index(const u16 address) const {
         return address - 0xA000 + (m_ram_bank_number % m_num_ram_banks) * 8 * 1024;
     }
 
-    u8 read_ram(const u16 address) const override {
+    u8 read_ram(const u16 address) const {
         if (m_ram.empty()) {
             return 0xFF;  // No RAM present
         }
@@ -33,34 +37,93 @@ struct BaseMapper : IMapper {
         return m_ram.at(ram_address_to_index(address));
     }
 
-    void write_ram(const u16 address, const u8 value) override {
+    void write_ram(const u16 address, const u8 value) {
         if (m_ram.empty()) {
             return;  // No RAM present
         }
 
-        m_ram.at(ram_address_to_index(address)) = value;
+        store_ram(address, value);
     }
 
     std::span<u8> get_ram() { return m_ram; }
 
+    /// Pages of get_ram() written since the last clear(), e.g. to only flush those to a battery save
+    DirtyPages& get_ram_dirty_pages() { return m_ram_dirty_pages; }
+
+    /// Banks currently mapped, for the bus to access directly. Stays at the same address while the mapper exists.
+    [[nodiscard]] const MappedBanks& get_banks() const { return m_banks; }
+
+    /// Recompute get_banks() from the banking registers, after they changed
+    void update_banks() { map_banks(1, true); }
+
+    /// Throws std::runtime_error when loading a state with a different RAM size, since the RAM is sized once, by the
+    /// header: its dirty pages, the banks mapped into the bus and the battery save all keep that size.
     void serialize(auto& ar) {
         ar(m_ram_bank_number);
-        ar(m_ram);
+        if constexpr (std::remove_reference_t<decltype(ar)>::is_loading) {
+            m_ram_dirty_pages.mark_all();
+
+            size_t size = 0;
+            ar(size);
+            if (size != m_ram.size()) {
+                throw std::runtime_error("Save state has a different cartridge RAM size");
+            }
+            ar(std::span<u8>{m_ram});
+        } else {
+            ar(m_ram);
+        }
     }
 
    protected:
+    /// Map ROM bank rom_bank at 4000-7FFF, and the current RAM bank (see ram_address_to_index()) if ram_enabled. Banks
+    /// not entirely present in the ROM or RAM are left unmapped, so accesses to them go through the mapper.
+    void map_banks(const size_t rom_bank, const bool ram_enabled) {
+        const auto map_rom_bank = [&](const size_t bank) -> const u8* {
+            return (bank + 1) * 0x4000 <= m_data.size() ? m_data.data() + bank * 0x4000 : nullptr;
+        };
+        m_banks.m_rom_bank_0 = map_rom_bank(0);
+        m_banks.m_rom_bank_n = map_rom_bank(rom_bank);
+
+        m_banks.m_ram_bank = nullptr;
+        m_banks.m_ram_dirty_pages = &m_ram_dirty_pages;
+        if (ram_enabled && m_ram.size() >= 0x2000) {
+            const auto offset = ram_address_to_index(0xA000);
+            if (offset + 0x2000 <= m_ram.size()) {
+                m_banks.m_ram_bank = m_ram.data() + offset;
+                m_banks.m_ram_bank_offset = offset;
+            }
+        }
+    }
+
+    /// Throws std::out_of_range if the ROM file is smaller than its header claims
+    u8 read_rom_byte(const size_t index) const {
+        if (index >= m_data.size()) {
+            throw std::out_of_range("ROM address out of range");
+        }
+        return m_data[index];
+    }
+
+    /// Write to the currently mapped RAM bank
+    void store_ram(const u16 address, const u8 value) {
+        const auto index = ram_address_to_index(address);
+        m_ram.at(index) = value;
+        m_ram_dirty_pages.mark(index);
+    }
+
     u8 m_ram_bank_number = 0;
 
     u8 m_num_rom_banks = 0;
     u8 m_num_ram_banks = 0;
-    std::vector<u8>& m_data;
+    std::span<const u8> m_data;  ///< ROM, owned by the cartridge
     std::vector<u8> m_ram;
+    DirtyPages m_ram_dirty_pages;
+    MappedBanks m_banks;
 };
 
 struct MBC0 : BaseMapper {
     using BaseMapper::BaseMapper;
 
-    u8 read_rom(const u16 address) const override { return m_data.at(address); }
-    void write_rom(const u16 address, const u8 value) override {}
+    u8 read_rom(const u16 address) const { return read_rom_byte(address); }
+    void write_rom(const u16 address, const u8 value) {}
 };
 }  // namespace bemu::gb
\ No newline at end of file
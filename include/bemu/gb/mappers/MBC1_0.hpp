@@ -22,18 +22,18 @@ namespace bemu::gb {
 struct MBC1_0 : BaseMapper {
     using BaseMapper::BaseMapper;
 
-    u8 read_rom(const u16 address) const override {
+    u8 read_rom(const u16 address) const {
         // 0000–3FFF - ROM Bank X0 [read-only]
         if (address <= 0x3FFF) {
-            return m_data.at(address);
+            return read_rom_byte(address);
         }
 
         // 4000–7FFF — ROM Bank 01-7F
         const auto a = 0x4000 * m_rom_bank_number + (address - 0x4000);
-        return m_data.at(a);
+        return read_rom_byte(a);
     }
 
-    void write_rom(const u16 address, u8 value) override {
+    void write_rom(const u16 address, u8 value) {
         // 0000-1FFF - RAM Enable (Write Only)
         //
         // Before external RAM can be read or written, it must be enabled by writing $A to anywhere in this address
@@ -96,9 +96,11 @@ struct MBC1_0 : BaseMapper {
         else if (0x6000 <= address && address <= 0x7FFF) {
             // We only support up to 8 KiB RAM and 512 KiB ROM, so this is always regular RAM banking mode
         }
+
+        update_banks();
     }
 
-    u8 read_ram(const u16 address) const override {
+    u8 read_ram(const u16 address) const {
         if (m_ram.empty() || !m_ram_enabled) {
             return 0xFF;
         }
@@ -106,14 +108,16 @@ struct MBC1_0 : BaseMapper {
         return m_ram.at(ram_address_to_index(address));
     }
 
-    void write_ram(const u16 address, const u8 value) override {
+    void write_ram(const u16 address, const u8 value) {
         if (m_ram.empty() || !m_ram_enabled) {
             return;
         }
 
-        m_ram.at(ram_address_to_index(address)) = value;
+        store_ram(address, value);
     }
 
+    void update_banks() { map_banks(m_rom_bank_number, m_ram_enabled); }
+
     void serialize(auto &ar) {
         BaseMapper::serialize(ar);
         ar(m_rom_bank_number);
@@ -1,9 +1,131 @@
 #pragma once
-#include <chrono>
+#include <array>
 
 #include "MBC0.hpp"
 
 namespace bemu::gb {
+/// Real Time Clock of the MBC3, counting emulated time
+///
+/// The clock only advances when it is accessed: sync() adds the time elapsed since the previous access, measured in
+/// dots of the emulator (see ICycler::get_tick_count()). So it follows emulated time rather than host time:
+/// fast-forwarding ages it by the emulated time, and replays and rewind see exactly the same clock.
+struct RealTimeClock {
+    static constexpr u64 dots_per_second = 4 * 1024 * 1024;
+
+    /// RTC registers, selected by writing their number to 4000-5FFF
+    enum Register : u8 {
+        Seconds = 0x08,
+        Minutes = 0x09,
+        Hours = 0x0A,
+        DaysLow = 0x0B,   ///< Lower 8 bits of the day counter
+        DaysHigh = 0x0C,  ///< Bit 0: bit 8 of the day counter, bit 6: halt, bit 7: day counter carry
+    };
+    static constexpr u8 days_high_halt = 1 << 6;
+    static constexpr u8 days_high_carry = 1 << 7;
+
+    [[nodiscard]] static bool is_register(const u8 number) { return Seconds <= number && number <= DaysHigh; }
+
+    /// Bring the registers up to date at dot count now
+    void sync(const u64 now) {
+        // E.g. a state without the clock was loaded: count from now on
+        if (now <= m_synced_at) {
+            m_synced_at = now;
+            return;
+        }
+
+        const auto elapsed = now - m_synced_at;
+        m_synced_at = now;
+        if ((get(DaysHigh) & days_high_halt) != 0) {
+            return;
+        }
+
+        m_dots += elapsed;
+        advance(m_dots / dots_per_second);
+        m_dots %= dots_per_second;
+    }
+
+    /// Copy the current time into the registers read by read()
+    void latch(const u64 now) {
+        sync(now);
+        m_latched = m_registers;
+    }
+
+    [[nodiscard]] u8 read(const u8 number) const { return m_latched[number - Seconds]; }
+
+    void write(const u8 number, const u8 value, const u64 now) {
+        static constexpr std::array<u8, 5> masks = {0x3F, 0x3F, 0x1F, 0xFF, 0xC1};
+
+        sync(now);
+        get(number) = value & masks[number - Seconds];
+        if (number == Seconds) {
+            m_dots = 0;  // Writing the seconds resets the divider
+        }
+    }
+
+    void serialize(auto &ar) {
+        ar(m_registers);
+        ar(m_latched);
+        ar(m_synced_at);
+        ar(m_dots);
+    }
+
+    std::array<u8, 5> m_registers{};  ///< Running time, in the order of Register
+    std::array<u8, 5> m_latched{};    ///< Time at the last latch()
+    u64 m_synced_at = 0;              ///< Dot count at which m_registers were last brought up to date
+    u64 m_dots = 0;                   ///< Dots counted towards the next second
+
+   private:
+    [[nodiscard]] u8 &get(const u8 number) { return m_registers[number - Seconds]; }
+
+    /// Add one to value, which wraps at its bit mask. Returns true if it reached limit, which wraps to 0 and carries.
+    static bool count(u8 &value, const u8 limit, const u8 mask) {
+        value = (value + 1) & mask;
+        if (value == limit) {
+            value = 0;
+            return true;
+        }
+        return false;
+    }
+
+    void tick() {
+        if (!count(get(Seconds), 60, 0x3F) || !count(get(Minutes), 60, 0x3F) || !count(get(Hours), 24, 0x1F)) {
+            return;
+        }
+
+        const auto days = ((get(DaysHigh) & 1) << 8 | get(DaysLow)) + 1;
+        set_days(days);
+    }
+
+    void advance(u64 seconds) {
+        // Registers written out of range count up to their bit width and wrap without carrying, like the hardware.
+        // Step through those seconds; all others can be added at once.
+        while (seconds > 0 && (get(Seconds) >= 60 || get(Minutes) >= 60 || get(Hours) >= 24)) {
+            tick();
+            --seconds;
+        }
+        if (seconds == 0) {
+            return;
+        }
+
+        const u64 days = (get(DaysHigh) & 1) << 8 | get(DaysLow);
+        auto total = get(Seconds) + 60 * (get(Minutes) + 60 * (get(Hours) + 24 * days)) + seconds;
+        get(Seconds) = total % 60;
+        total /= 60;
+        get(Minutes) = total % 60;
+        total /= 60;
+        get(Hours) = total % 24;
+        set_days(total / 24);
+    }
+
+    /// Set the day counter, which sets the carry flag when it overflows
+    void set_days(const u64 days) {
+        if (days >= 512) {
+            get(DaysHigh) |= days_high_carry;
+        }
+        get(DaysLow) = days & 0xFF;
+        get(DaysHigh) = (get(DaysHigh) & ~1) | (days >> 8 & 1);
+    }
+};
 
 /// MBC3
 /// (max 2MByte ROM and/or 32KByte RAM and Timer)
@@ -14,22 +136,22 @@ namespace bemu::gb {
 struct MBC3 : BaseMapper {
     using BaseMapper::BaseMapper;
 
-    u8 read_rom(const u16 address) const override {
+    u8 read_rom(const u16 address) const {
         // 0000-3FFF - ROM Bank 00 (Read Only)
         //
         // Contains the first 16 KiB of the ROM.
         if (address <= 0x3FFF) {
-            return m_data.at(address);
+            return read_rom_byte(address);
         }
 
         // 4000-7FFF - ROM Bank 01-7F (Read Only)
         //
         // Same as for MBC1, except that accessing banks $20, $40, and $60 is supported now.
         const auto a = 0x4000 * m_rom_bank_number + (address - 0x4000);
-        return m_data.at(a);
+        return read_rom_byte(a);
     }
 
-    void write_rom(const u16 address, u8 value) override {
+    void write_rom(const u16 address, u8 value) {
         // 0000-1FFF - RAM and Timer Enable (Write Only)
         //
         // Mostly the same as for MBC1, a value of $0A will enable reading and writing to external RAM - and to the RTC
@@ -78,54 +200,79 @@ struct MBC3 : BaseMapper {
         // provides a way to read the RTC registers while the clock keeps ticking.
         else if (address <= 0x7FFF) {
             if (m_last_latch_write == 0 && value == 1) {
-                last_latch = std::chrono::system_clock::now();
+                m_rtc.latch(get_time());
             }
             m_last_latch_write = value;
         }
+
+        update_banks();
     }
 
-    u8 read_ram(const u16 address) const override {
-        if (m_ram.empty() || !m_ram_enabled) {
+    u8 read_ram(const u16 address) const {
+        if (!m_ram_enabled) {
             return 0xFF;
         }
 
-        // RTC
+        // A000-BFFF - RTC Register 08-0C (Read/Write)
+        //
+        // Depending on the current Bank Number/RTC Register selection, this memory space is mapped to RAM or to a
+        // single RTC register, which reads its latched value.
         if (m_ram_bank_number > 0x07) {
-            // TODO
-            return 0x00;
+            return RealTimeClock::is_register(m_ram_bank_number) ? m_rtc.read(m_ram_bank_number) : 0xFF;
         }
 
+        if (m_ram.empty()) {
+            return 0xFF;
+        }
         return m_ram.at(ram_address_to_index(address));
     }
 
-    void write_ram(const u16 address, const u8 value) override {
-        if (m_ram.empty() || !m_ram_enabled) {
+    void write_ram(const u16 address, const u8 value) {
+        if (!m_ram_enabled) {
             return;
         }
 
-        // RTC
         if (m_ram_bank_number > 0x07) {
-            // TODO
+            if (RealTimeClock::is_register(m_ram_bank_number)) {
+                m_rtc.write(m_ram_bank_number, value, get_time());
+            }
             return;
         }
 
-        m_ram.at(ram_address_to_index(address)) = value;
+        if (!m_ram.empty()) {
+            store_ram(address, value);
+        }
     }
 
+    /// Source of emulated time for the RTC. Until connected, time stands still.
+    void connect(const ICycler &clock) { m_clock = &clock; }
+
+    void update_banks() { map_banks(m_rom_bank_number, m_ram_enabled && m_ram_bank_number <= 0x07); }
+
     void serialize(auto &ar) {
         BaseMapper::serialize(ar);
 
-        // ar(m_last_latch_write);
-        // ar(last_latch);
         ar(m_rtc_register_select);
         ar(m_rom_bank_number);
         ar(m_ram_enabled);
     }
 
+    /// Separate from serialize(), which keeps the layout of earlier save state files (see StateSection::Rtc)
+    void serialize_rtc(auto &ar) {
+        m_rtc.serialize(ar);
+        ar(m_last_latch_write);
+    }
+
     u8 m_last_latch_write = 0xFF;
-    std::chrono::system_clock::time_point last_latch = std::chrono::system_clock::now();
-    bool m_rtc_register_select = false;  ///< If set, reads RTC registers instead of RAM
+    /// Unused: m_ram_bank_number selects the RTC registers. Kept only for the layout of the Cartridge section.
+    bool m_rtc_register_select = false;
     u8 m_rom_bank_number = 1;
     bool m_ram_enabled = true;
+    RealTimeClock m_rtc;
+
+   private:
+    [[nodiscard]] u64 get_time() const { return m_clock != nullptr ? m_clock->get_tick_count() : 0; }
+
+    const ICycler *m_clock = nullptr;
 };
 }  // namespace bemu::gb
\ No newline at end of file
@@ -14,22 +14,22 @@ namespace bemu::gb {
 struct MBC5 : BaseMapper {
     using BaseMapper::BaseMapper;
 
-    u8 read_rom(const u16 address) const override {
+    u8 read_rom(const u16 address) const {
         // 0000-3FFF - ROM Bank 00 (Read Only)
         //
         // Contains the first 16 KiB of the ROM.
         if (address <= 0x3FFF) {
-            return m_data.at(address);
+            return read_rom_byte(address);
         }
 
         // 4000-7FFF - ROM Bank 01-7F (Read Only)
         //
         // Same as for MBC1, except that accessing up to bank $1FF is supported now. Also, bank 0 is actually bank 0.
         const auto a = 0x4000 * m_rom_bank_number + (address - 0x4000);
-        return m_data.at(a);
+        return read_rom_byte(a);
     }
 
-    void write_rom(const u16 address, u8 value) override {
+    void write_rom(const u16 address, u8 value) {
         // 0000-1FFF - RAM and Timer Enable (Write Only)
         //
         // Mostly the same as for MBC1. Writing $0A will enable reading and writing to external RAM. Writing $00 will
@@ -64,9 +64,11 @@ struct MBC5 : BaseMapper {
         else if (address <= 0x5FFF) {
             m_ram_bank_number = value & 0b1111;
         }
+
+        update_banks();
     }
 
-    u8 read_ram(const u16 address) const override {
+    u8 read_ram(const u16 address) const {
         // A000-BFFF - RAM bank 00-0F, if any (Read/Write)
         //
         // Same as for MBC1, except that RAM sizes are 8 KiB, 32 KiB and 128 KiB.
@@ -77,14 +79,16 @@ struct MBC5 : BaseMapper {
         return m_ram.at(ram_address_to_index(address));
     }
 
-    void write_ram(const u16 address, const u8 value) override {
+    void write_ram(const u16 address, const u8 value) {
         if (m_ram.empty() || !m_ram_enabled) {
             return;
         }
 
-        m_ram.at(ram_address_to_index(address)) = value;
+        store_ram(address, value);
     }
 
+    void update_banks() { map_banks(m_rom_bank_number, m_ram_enabled); }
+
     void serialize(auto &ar) {
         BaseMapper::serialize(ar);
         ar(m_rom_bank_number);
@@ -1,7 +1,10 @@
 #pragma once
+#include <array>
+#include <span>
 #include <vector>
 
 #include "../types.hpp"
+#include "dirty_pages.hpp"
 #include "interfaces.hpp"
 
 namespace bemu::gb {
@@ -14,19 +17,67 @@ struct NoopRegion final : IMemoryRegion {
     void write(u16 address, u8 value) override {}
 };
 
+/// Regions in the order they were added; the first one containing an address handles it
+///
+/// I/O registers (FF00-FF7F and FFFF) are looked up in a table instead of searching the regions, since games poll
+/// registers like LY, STAT and IF in tight loops. Regions must therefore always contain the same addresses.
 struct MemoryMap : IMemoryRegion {
     std::vector<IMemoryRegion*> m_regions;
 
+    /// Region of each I/O register, FF00-FF7F and then FFFF, or nullptr if none contains it
+    std::array<IMemoryRegion*, 0x81> m_io_regions{};
+
+    void add(IMemoryRegion& region);
+
+    /// Region handling address, or nullptr if none contains it
+    [[nodiscard]] IMemoryRegion* find_region(u16 address) const;
+
     [[nodiscard]] bool contains(u16 address) const override;
     [[nodiscard]] u8 read(u16 address) const override;
     void write(u16 address, u8 value) override;
 };
 
+/// Host memory of the cartridge banks currently mapped into the address space, kept up to date by the mapper
+///
+/// The bus reads and writes through these pointers directly, instead of through the memory map and the virtual calls
+/// of the cartridge and its mapper. A null pointer means accesses must go through the mapper, e.g. because RAM is
+/// disabled, or an RTC register is mapped instead.
+struct MappedBanks {
+    const u8* m_rom_bank_0 = nullptr;  ///< 0000-3FFF
+    const u8* m_rom_bank_n = nullptr;  ///< 4000-7FFF
+    u8* m_ram_bank = nullptr;          ///< A000-BFFF
+    size_t m_ram_bank_offset = 0;      ///< Of m_ram_bank in the cartridge RAM
+    DirtyPages* m_ram_dirty_pages = nullptr;
+};
+
 struct MemoryBus {
+    /// Accessors for a bus whose regions are fixed at compile time, handling every address without searching the
+    /// memory map (see Bus). Without them, accesses go through the regions added with add_region().
+    struct StaticMap {
+        u8 (*m_read)(const MemoryBus& bus, u16 address) = nullptr;
+        void (*m_write)(MemoryBus& bus, u16 address, u8 value) = nullptr;
+    };
+
     explicit MemoryBus(ICycler* cycler = nullptr);
 
     void add_region(IMemoryRegion& region);
 
+    void set_static_map(const StaticMap& map) { m_static_map = map; }
+
+    /// Regions added with add_region()
+    [[nodiscard]] const MemoryMap& get_map() const { return m_map; }
+
+    /// Access the cartridge through banks (which must outlive the bus) where possible, see MappedBanks
+    void set_cartridge_banks(const MappedBanks& banks) { m_cartridge_banks = &banks; }
+
+    /// Host memory of the cartridge bank mapped at address, from address to the end of the bank. Empty if the bank
+    /// must be accessed through the mapper, see MappedBanks.
+    [[nodiscard]] std::span<const u8> find_cartridge_memory(u16 address) const;
+
+    /// Number of writes which may have switched a bank: to the mapper registers, or to SVBK. Host memory found for an
+    /// address, e.g. by find_cartridge_memory(), is only valid while this is unchanged.
+    [[nodiscard]] size_t get_bank_switch_count() const { return m_bank_switch_count; }
+
     [[nodiscard]] u8 peek_u8(u16 address) const;
     [[nodiscard]] u16 peek_u16(u16 address) const;
     [[nodiscard]] u8 read_u8(u16 address) const;
@@ -36,8 +87,19 @@ struct MemoryBus {
     void write_u8(u16 address, u8 value);
     void write_u16(u16 address, u16 value);
 
+   protected:
+    MemoryMap m_map;
+
    private:
+    /// Write to cartridge RAM through m_cartridge_banks, if it is mapped there
+    bool write_cartridge_ram(u16 address, u8 value);
+
+    /// Write to the region of address, through m_static_map if set
+    void write_region(u16 address, u8 value);
+
     ICycler* m_cycler = nullptr;
-    MemoryMap m_map;
+    const MappedBanks* m_cartridge_banks = nullptr;
+    StaticMap m_static_map;
+    size_t m_bank_switch_count = 0;
 };
 }  // namespace bemu::gb
@@ -0,0 +1,58 @@
+#pragma once
+#include <charconv>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace bemu::gb {
+/// Command line options shared by the frontends
+struct Options {
+    std::string m_rom;
+
+    /// Number of frames to run ahead, to hide the game's input lag. 0 disables run-ahead.
+    size_t m_run_ahead_frames = 0;
+
+    /// Number of worker threads predicting the next frame for likely inputs. 0 runs everything on the main thread.
+    size_t m_speculative_threads = 0;
+
+    /// Directory to save the state to on exit, and resume it from on start (see hibernate()). Empty disables it.
+    std::string m_hibernate_directory;
+
+    /// Parse the command line. Returns std::nullopt if the arguments are invalid.
+    static std::optional<Options> parse(const int argc, const char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+
+            if (arg == "--run-ahead" && i + 1 < argc) {
+                if (!parse_number(argv[++i], options.m_run_ahead_frames)) return std::nullopt;
+            } else if (arg == "--speculate" && i + 1 < argc) {
+                if (!parse_number(argv[++i], options.m_speculative_threads)) return std::nullopt;
+            } else if (arg == "--hibernate" && i + 1 < argc) {
+                options.m_hibernate_directory = argv[++i];
+            } else if (!arg.starts_with("-") && options.m_rom.empty()) {
+                options.m_rom = arg;
+            } else {
+                return std::nullopt;
+            }
+        }
+
+        if (options.m_rom.empty()) return std::nullopt;
+        return options;
+    }
+
+    static std::string usage(const std::string_view program) {
+        return std::string{program} +
+               " [options] <rom>\n"
+               "  --run-ahead <frames>   Run this many frames ahead to hide input lag (default 0)\n"
+               "  --speculate <threads>  Predict the next frame for likely inputs on worker threads (default 0)\n"
+               "  --hibernate <dir>      Save the state in dir on exit, and resume from it on the next start\n";
+    }
+
+   private:
+    static bool parse_number(const std::string_view text, size_t& value) {
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return error == std::errc{} && end == text.data() + text.size();
+    }
+};
+}  // namespace bemu::gb
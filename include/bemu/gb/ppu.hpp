@@ -2,6 +2,7 @@
 #pragma once
 
 #include <chrono>
+#include <span>
 
 #include "../types.hpp"
 #include "ram.hpp"
@@ -77,7 +78,44 @@ struct OamRamData {
 #pragma pack(pop)
 static_assert(sizeof(OamRamData) == 40 * sizeof(OamEntry));
 
-struct OamRam : MemoryRegion<0xFE00, OamRamData> {};
+struct OamRam : MemoryRegion<0xFE00, OamRamData> {
+    OamRam(OamRamData& data, DirtyPages& dirty_pages, const size_t offset)
+        : MemoryRegion(data), m_dirty_pages(dirty_pages), m_offset(offset) {
+        m_dirty_pages.track(m_offset, sizeof(OamRamData));
+    }
+
+    void write(const u16 address, const u8 value) override {
+        MemoryRegion::write(address, value);
+        m_dirty_pages.mark(m_offset + (address - 0xFE00));
+    }
+
+    /// Write byte index of OAM, without the address checks of write(), for DMA transfers
+    void write_byte(const size_t index, const u8 value) {
+        data()[index] = value;
+        m_dirty_pages.mark(m_offset + index);
+    }
+
+   private:
+    DirtyPages& m_dirty_pages;
+    size_t m_offset;  ///< Of m_data within MachineState
+};
+
+/// Progress of an OAM DMA transfer, stored in MachineState
+struct DmaTransfer {
+    bool m_active = false;
+    u8 m_start_delay = 0;
+    u8 m_written_value = 0;
+    u8 m_current_byte = 0;
+    bool m_transferring = false;
+};
+
+/// Video memory and PPU progress, stored in MachineState
+struct PpuState {
+    RAM<0x8000, 0x9FFF>::Data m_vram;
+    OamRamData m_oam;
+    DmaTransfer m_oam_dma;
+    u32 m_frame_tick = 0;  ///< Dot tick within current frame
+};
 
 /// Handler for OAM DMA transfers, controlled by register 0xFF46
 ///
@@ -91,9 +129,21 @@ struct OamRam : MemoryRegion<0xFE00, OamRamData> {};
 ///
 /// The transfer takes 160 M-cycles: 640 dots (1.4 lines) in normal speed, or 320 dots (0.7 lines) in CGB Double
 /// Speed Mode. This is much faster than a CPU-driven copy.
+///
+/// The source is resolved to host memory when the transfer starts (see Bus::find_memory()), and one byte is copied
+/// from it each M-cycle, so the PPU sees OAM being filled as on hardware. It is resolved again after a write which may
+/// switch the source bank (see MemoryBus::get_bank_switch_count()). Sources without host memory, e.g. VRAM or banks
+/// handled by the mapper, are read through the bus instead.
 struct DmaState {
     Bus &m_bus;
     OamRam &m_oam;  ///< DMA can access the OAM, regardless of PPU state
+    DmaTransfer &m_state;
+
+    /// Host memory of the source, valid if m_source_resolved and no bank was switched since. Pointers cannot be stored
+    /// in MachineState, so loading a state must call reset_source().
+    std::span<const u8> m_source{};
+    bool m_source_resolved = false;
+    size_t m_source_bank_switch_count = 0;
 
     [[nodiscard]] bool contains(u16 address) const;
     [[nodiscard]] u8 read(u16 address) const;
@@ -101,32 +151,31 @@ struct DmaState {
 
     void cycle_tick();
 
-    bool m_active = false;
-    u8 m_start_delay = 0;
-    u8 m_written_value = 0;
-    u8 m_current_byte = 0;
-    bool m_transferring = false;
+    /// Resolve the source again on the next cycle, after the banks may have changed
+    void reset_source() { m_source_resolved = false; }
 
     void serialize(auto &ar) {
-        ar(m_active);
-        ar(m_start_delay);
-        ar(m_written_value);
-        ar(m_current_byte);
-        ar(m_transferring);
+        ar(m_state.m_active);
+        ar(m_state.m_start_delay);
+        ar(m_state.m_written_value);
+        ar(m_state.m_current_byte);
+        ar(m_state.m_transferring);
     }
 };
 
-struct Ppu : IMemoryRegion, ICycled {
+struct Ppu final : IMemoryRegion, ICycled {
     External &m_external;
     Bus &m_bus;
     Lcd &m_lcd;
     Cpu &m_cpu;
-    RAM<0x8000, 0x9FFF> m_vram{};
+    PpuState &m_state;
+    RAM<0x8000, 0x9FFF> m_vram;
     OamRam m_oam;
     DmaState m_oam_dma;
-    u32 m_frame_tick = 0;  ///< Dot tick within current frame
 
-    explicit Ppu(External &external, Bus &bus, Lcd &lcd, Cpu &cpu);
+    /// offset: of state within MachineState, for dirty_pages
+    explicit Ppu(PpuState &state, DirtyPages &dirty_pages, size_t offset, External &external, Bus &bus, Lcd &lcd,
+                 Cpu &cpu);
 
     [[nodiscard]] bool contains(u16 address) const override;
     [[nodiscard]] u8 read(u16 address) const override;
@@ -139,7 +188,7 @@ struct Ppu : IMemoryRegion, ICycled {
         m_vram.serialize(ar);
         m_oam.serialize(ar);
         m_oam_dma.serialize(ar);
-        ar(m_frame_tick);
+        ar(m_state.m_frame_tick);
     }
 
    private:
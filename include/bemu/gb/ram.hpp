@@ -1,9 +1,11 @@
 #pragma once
 #include <array>
+#include <cstddef>
 #include <span>
 #include <stdexcept>
 
 #include "../types.hpp"
+#include "dirty_pages.hpp"
 #include "interfaces.hpp"
 
 namespace bemu::gb {
@@ -20,9 +22,13 @@ namespace bemu::gb {
 ///     \endcode
 /// Note that the requires clause requires(alignof(TStruct) == 1) does not guarantee that the struct is packed, so you
 /// must still ensure that yourself.
+///
+/// The data itself is owned by MachineState; the region only maps it into the address space.
 template <size_t Begin, typename TStruct>
     requires(alignof(TStruct) == 1)
 struct MemoryRegion : IMemoryRegion {
+    explicit MemoryRegion(TStruct& data) : m_data(data) {}
+
     [[nodiscard]] bool contains(const u16 address) const override {
         return Begin <= address && address < Begin + sizeof(TStruct);
     }
@@ -47,74 +53,105 @@ struct MemoryRegion : IMemoryRegion {
 
     void serialize(auto& ar) { ar(data()); }
 
-    TStruct m_data;
+    TStruct& m_data;
 };
 
-/// Blob of contiguous data
+/// Blob of contiguous data, owned by MachineState
+///
+/// Writes are marked in the machine's DirtyPages, at the data's offset within MachineState.
 template <size_t Begin, size_t End>
-struct RAM : IMemoryRegion {
+struct RAM final : IMemoryRegion {
     constexpr static size_t first_address = Begin;
+    using Data = std::array<u8, End - Begin + 1>;
+
+    RAM(Data& data, DirtyPages& dirty_pages, const size_t offset)
+        : m_data(data), m_dirty_pages(dirty_pages), m_offset(offset) {
+        m_dirty_pages.track(m_offset, sizeof(Data));
+    }
 
     [[nodiscard]] bool contains(const u16 address) const override { return Begin <= address && address <= End; }
 
     [[nodiscard]] u8 read(const u16 address) const override { return m_data.at(address - Begin); }
 
-    void write(const u16 address, const u8 value) override { m_data.at(address - Begin) = value; }
+    void write(const u16 address, const u8 value) override {
+        m_data.at(address - Begin) = value;
+        m_dirty_pages.mark(m_offset + (address - Begin));
+    }
 
     std::span<u8> data() { return m_data; }
 
     void serialize(auto& ar) { ar(m_data); }
 
    private:
-    std::array<u8, End - Begin + 1> m_data;
+    Data& m_data;
+    DirtyPages& m_dirty_pages;
+    size_t m_offset;  ///< Of m_data within MachineState
 };
 
-struct WRAM : IMemoryRegion {
-    bool contains(const u16 address) const override { return switchable().contains(address) || address == 0xFF70; }
+/// Switchable WRAM banks, stored in MachineState
+struct WramState {
+    std::array<RAM<0xD000, 0xDFFF>::Data, 7> m_banks;
+    u8 m_selected_bank = 1;
+};
+
+struct WRAM final : IMemoryRegion {
+    WRAM(WramState& state, DirtyPages& dirty_pages, const size_t offset)
+        : m_state(state), m_dirty_pages(dirty_pages), m_offset(offset) {
+        m_dirty_pages.track(m_offset + offsetof(WramState, m_banks), sizeof(WramState::m_banks));
+    }
+
+    bool contains(const u16 address) const override {
+        return (0xD000 <= address && address <= 0xDFFF) || address == 0xFF70;
+    }
 
     [[nodiscard]] u8 read(const u16 address) const override {
         if (address == 0xFF70) {
-            return m_selected_bank;
+            return m_state.m_selected_bank;
         }
 
-        return switchable().read(address);
+        return switchable().at(address - 0xD000);
     }
     void write(const u16 address, const u8 value) override {
         if (address == 0xFF70) {
-            m_selected_bank = value;
+            m_state.m_selected_bank = value;
             return;
         }
 
-        switchable().write(address, value);
+        auto& bank = switchable();
+        bank.at(address - 0xD000) = value;
+
+        const auto bank_offset = static_cast<size_t>(bank.data() - m_state.m_banks.front().data());
+        m_dirty_pages.mark(m_offset + offsetof(WramState, m_banks) + bank_offset + (address - 0xD000));
     }
 
-    RAM<0xD000, 0xDFFF>& switchable() {
+    RAM<0xD000, 0xDFFF>::Data& switchable() {
         // Writing 0 maps bank 1 instead
-        auto s = m_selected_bank & 0b111;
+        auto s = m_state.m_selected_bank & 0b111;
         if (s == 0) s = 1;
 
-        return m_switchable.at(s);
+        return m_state.m_banks.at(s);
     }
 
-    [[nodiscard]] const RAM<0xD000, 0xDFFF>& switchable() const {
+    [[nodiscard]] const RAM<0xD000, 0xDFFF>::Data& switchable() const {
         // Writing 0 maps bank 1 instead
-        auto s = m_selected_bank & 0b111;
+        auto s = m_state.m_selected_bank & 0b111;
         if (s == 0) s = 1;
 
-        return m_switchable.at(s);
+        return m_state.m_banks.at(s);
     }
 
     void serialize(auto& ar) {
-        for (auto& bank : m_switchable) {
-            bank.serialize(ar);
+        for (auto& bank : m_state.m_banks) {
+            ar(bank);
         }
 
-        ar(m_selected_bank);
+        ar(m_state.m_selected_bank);
     }
 
    private:
-    std::array<RAM<0xD000, 0xDFFF>, 7> m_switchable{};
-    u8 m_selected_bank = 1;
+    WramState& m_state;
+    DirtyPages& m_dirty_pages;
+    size_t m_offset;  ///< Of m_state within MachineState
 };
 
 }  // namespace bemu::gb
@@ -13,10 +13,10 @@ struct SerialRegisters {
 };
 #pragma pack(pop)
 
-struct SerialPort : MemoryRegion<0xFF01, SerialRegisters> {
+struct SerialPort final : MemoryRegion<0xFF01, SerialRegisters> {
     External &m_external;
 
-    explicit SerialPort(External &external) : m_external{external} {}
+    explicit SerialPort(SerialRegisters &data, External &external) : MemoryRegion(data), m_external{external} {}
 
     void write(const u16 address, const u8 value) override {
         MemoryRegion::write(address, value);
@@ -6,19 +6,8 @@
 namespace bemu::gb {
 struct Cpu;
 
-/// Timer and Divider Registers
-struct Timer : IMemoryRegion, ICycled {
-    explicit Timer(Cpu &cpu) : m_cpu{cpu} {}
-
-    [[nodiscard]] bool contains(u16 address) const override;
-    [[nodiscard]] u8 read(u16 address) const override;
-    void write(u16 address, u8 value) override;
-
-    /// Called every M-cycle
-    /// The timers are updated @ 16384 Hz, which is every 64 M-cycles on regular speed, and every 32 M-cycles on
-    /// double speed
-    void dot_tick() override;
-
+/// Timer registers, stored in MachineState
+struct TimerState {
     /// FF04 - DIV: Divider register
     ///
     /// This register is incremented at a rate of 16384Hz (~16779Hz on SGB). Writing any value to this register resets
@@ -59,20 +48,36 @@ struct Timer : IMemoryRegion, ICycled {
     /// Note that writing to this register may increase TIMA once!
     u8 tac = 0;
 
+    /// Used to stored whether we overflowed TIMA on the last dot tick.
+    ///
+    /// Needed because the interrupt is triggered one cycle after the overflow.
+    bool m_overflowed = false;
+};
+
+/// Timer and Divider Registers
+struct Timer final : IMemoryRegion, ICycled {
+    explicit Timer(TimerState &state, Cpu &cpu) : m_state{state}, m_cpu{cpu} {}
+
+    [[nodiscard]] bool contains(u16 address) const override;
+    [[nodiscard]] u8 read(u16 address) const override;
+    void write(u16 address, u8 value) override;
+
+    /// Called every M-cycle
+    /// The timers are updated @ 16384 Hz, which is every 64 M-cycles on regular speed, and every 32 M-cycles on
+    /// double speed
+    void dot_tick() override;
+
     void serialize(auto &ar) {
-        ar(div);
-        ar(tima);
-        ar(tma);
-        ar(tac);
-        ar(m_overflowed);
+        ar(m_state.div);
+        ar(m_state.tima);
+        ar(m_state.tma);
+        ar(m_state.tac);
+        ar(m_state.m_overflowed);
     }
 
+    TimerState &m_state;
+
    private:
     Cpu &m_cpu;
-
-    /// Used to stored whether we overflowed TIMA on the last dot tick.
-    ///
-    /// Needed because the interrupt is triggered one cycle after the overflow.
-    bool m_overflowed = false;
 };
 }  // namespace bemu::gb
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+#include <span>
+#include <string>
+
+#include "../types.hpp"
+
+namespace bemu {
+/// Replace the contents of a file, such that after a crash or power loss it holds either the old or the new contents
+///
+/// The data is written to a temporary file next to it, flushed to disk, and renamed over the file. Blocks until the
+/// data is on disk, so call it off the frame thread. Throws std::runtime_error on failure, leaving the file unchanged.
+void write_file_atomically(const std::string &filename, std::span<const u8> data);
+}  // namespace bemu
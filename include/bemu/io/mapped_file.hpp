@@ -0,0 +1,41 @@
+#pragma once
+#include <span>
+#include <string>
+
+#include "../types.hpp"
+
+namespace bemu {
+/// View of a whole file, mapped into memory
+///
+/// Pages are read from disk as they are first accessed, and shared with the OS file cache, so opening is cheap
+/// regardless of the file size.
+struct MappedFile {
+    /// Map an existing file read-only. Throws std::runtime_error if the file cannot be opened or mapped.
+    explicit MappedFile(const std::string &filename);
+
+    /// Map a file read-write, creating it if needed, and resizing it to size. New bytes are 0. Writes to
+    /// mutable_data() reach the file when the OS writes the pages back, or after flush().
+    ///
+    /// Throws std::runtime_error if the file cannot be opened, resized or mapped.
+    MappedFile(const std::string &filename, size_t size);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    [[nodiscard]] std::span<const u8> data() const { return {m_data, m_size}; }
+
+    /// Only for files mapped read-write
+    [[nodiscard]] std::span<u8> mutable_data() { return {m_data, m_writable ? m_size : 0}; }
+
+    /// Start writing the pages of [offset, offset + size) back to the file, without waiting for it. Pages are
+    /// written back eventually anyway; this bounds how much is lost if the system crashes.
+    void flush(size_t offset, size_t size);
+
+   private:
+    u8 *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_writable = false;
+    void *m_handle = nullptr;  ///< Mapping handle on Windows
+};
+}  // namespace bemu
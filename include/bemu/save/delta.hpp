@@ -0,0 +1,189 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "../types.hpp"
+
+namespace bemu::gb {
+namespace detail {
+inline void write_varint(std::vector<u8>& output, size_t value) {
+    while (value >= 0x80) {
+        output.push_back(static_cast<u8>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<u8>(value));
+}
+
+inline size_t read_varint(const std::span<const u8> input, size_t& index) {
+    size_t result = 0;
+    for (size_t shift = 0; shift < 64; shift += 7) {
+        if (index >= input.size()) {
+            throw std::runtime_error("Delta truncated");
+        }
+
+        const auto byte = input[index++];
+        result |= static_cast<size_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return result;
+        }
+    }
+    throw std::runtime_error("Delta varint too long");
+}
+
+/// XOR of the 8 bytes at the given position of both buffers
+inline u64 xor_word(const u8* a, const u8* b) {
+    u64 word_a = 0;
+    u64 word_b = 0;
+    std::memcpy(&word_a, a, sizeof(u64));
+    std::memcpy(&word_b, b, sizeof(u64));
+    return word_a ^ word_b;
+}
+
+/// Offset of the first (lowest address) differing byte in a non-zero xor_word()
+inline size_t first_differing_byte(const u64 x) {
+    if constexpr (std::endian::native == std::endian::little) {
+        return std::countr_zero(x) / 8;
+    } else {
+        return std::countl_zero(x) / 8;
+    }
+}
+
+/// Offset of the last (highest address) differing byte in a non-zero xor_word()
+inline size_t last_differing_byte(const u64 x) {
+    if constexpr (std::endian::native == std::endian::little) {
+        return 7 - std::countl_zero(x) / 8;
+    } else {
+        return 7 - std::countr_zero(x) / 8;
+    }
+}
+
+/// Index of the first byte in [index, end) where a and b differ, or end
+inline size_t find_difference(const u8* a, const u8* b, size_t index, const size_t end) {
+    while (index + 32 <= end) {
+        const auto x = xor_word(a + index, b + index) | xor_word(a + index + 8, b + index + 8) |
+                       xor_word(a + index + 16, b + index + 16) | xor_word(a + index + 24, b + index + 24);
+        if (x != 0) break;
+        index += 32;
+    }
+
+    while (index + 8 <= end) {
+        if (const auto x = xor_word(a + index, b + index); x != 0) {
+            return index + first_differing_byte(x);
+        }
+        index += 8;
+    }
+
+    while (index < end && a[index] == b[index]) {
+        ++index;
+    }
+    return index;
+}
+
+/// End of the run of changes starting at index: one past the last differing byte before 8 equal bytes, or end
+inline size_t find_run_end(const u8* a, const u8* b, size_t index, const size_t end) {
+    size_t run_end = index + 1;
+    while (index + 8 <= end) {
+        const auto x = xor_word(a + index, b + index);
+        if (x == 0) {
+            return run_end;
+        }
+        run_end = index + last_differing_byte(x) + 1;
+        index += 8;
+    }
+
+    for (; index < end; ++index) {
+        if (a[index] != b[index]) {
+            run_end = index + 1;
+        }
+    }
+    return run_end;
+}
+}  // namespace detail
+
+/// Range of bytes [m_offset, m_offset + m_size)
+struct ByteRange {
+    size_t m_offset = 0;
+    size_t m_size = 0;
+};
+
+/// Delta codec for save states
+///
+/// Encodes new data as the changes against a base of (usually) the same size:
+///
+///     varint size                    Size of the new data
+///     { varint skip, varint length,  Unchanged bytes since the previous run, changed bytes in this run
+///       u8 data[length] }*           New contents of the run
+///
+/// The encoder compares 32 bytes at a time while skipping unchanged data, and 8 bytes at a time inside runs. Runs end
+/// at the first 8 unchanged bytes, so short gaps inside a changed region don't cost a run header each. Decoding is a
+/// copy of the base followed by one memcpy per run.
+///
+/// The new data may be longer or shorter than the base; bytes past the end of the base are always stored in full.
+///
+/// Appends the delta from base to data to output, only comparing the bytes within ranges: everything else must be
+/// known to be equal to the base, e.g. because it is outside the pages dirtied since the base was saved. The ranges
+/// must be sorted and must not overlap, and may extend past the end of the data.
+inline void encode_delta(const std::span<const u8> base, const std::span<const u8> data, std::vector<u8>& output,
+                         const std::span<const ByteRange> ranges) {
+    detail::write_varint(output, data.size());
+
+    const auto common = std::min(base.size(), data.size());
+    const auto write_run = [&](const size_t skip, const size_t begin, const size_t end) {
+        detail::write_varint(output, skip);
+        detail::write_varint(output, end - begin);
+        output.insert(output.end(), data.begin() + begin, data.begin() + end);
+    };
+
+    size_t previous_end = 0;
+    for (const auto& range : ranges) {
+        const auto begin = std::min(range.m_offset, common);
+        const auto range_end = range.m_size < common - begin ? begin + range.m_size : common;
+        auto index = std::max(begin, previous_end);
+        while (index < range_end) {
+            index = detail::find_difference(base.data(), data.data(), index, range_end);
+            if (index == range_end) break;
+
+            const auto end = detail::find_run_end(base.data(), data.data(), index, range_end);
+            write_run(index - previous_end, index, end);
+            previous_end = end;
+            index = end;
+        }
+    }
+
+    if (data.size() > common) {
+        write_run(common - previous_end, common, data.size());
+    }
+}
+
+/// Appends the delta from base to data to output, comparing all of the data
+inline void encode_delta(const std::span<const u8> base, const std::span<const u8> data, std::vector<u8>& output) {
+    const ByteRange everything{0, data.size()};
+    encode_delta(base, data, output, {&everything, 1});
+}
+
+/// Reconstruct the data encoded by encode_delta() into output, replacing its contents
+inline void decode_delta(const std::span<const u8> base, const std::span<const u8> delta, std::vector<u8>& output) {
+    size_t index = 0;
+    const auto size = detail::read_varint(delta, index);
+
+    output.resize(size);
+    std::memcpy(output.data(), base.data(), std::min(size, base.size()));
+
+    size_t position = 0;
+    while (index < delta.size()) {
+        position += detail::read_varint(delta, index);
+        const auto length = detail::read_varint(delta, index);
+        if (position + length > size || index + length > delta.size()) {
+            throw std::runtime_error("Delta run out of bounds");
+        }
+
+        std::memcpy(output.data() + position, delta.data() + index, length);
+        position += length;
+        index += length;
+    }
+}
+}  // namespace bemu::gb
@@ -1,40 +1,281 @@
 #pragma once
-#include <fstream>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
+#include "../io/atomic_write.hpp"
+#include "../io/mapped_file.hpp"
 #include "../types.hpp"
+#include "lz.hpp"
 #include "save_state.hpp"
+#include "snapshot.hpp"
 
 namespace bemu::gb {
-struct FileOutputBuffer {
-    std::ofstream file;
+/// Save state file format
+///
+///     FileHeader                     Magic, version and number of sections
+///     SectionHeader[num_sections]    Where each section is, and how it is stored
+///     u8 data[]                      Contents of the sections
+///
+/// Each section holds one StateSection, serialized with Emulator::serialize_section(), optionally compressed with
+/// lz_compress(). Its checksum is the CRC-32 of the stored bytes, so corruption is found before anything is loaded.
+/// Sections with an unknown id are skipped, so sections can be added without breaking older readers.
+///
+/// Files are read through a memory mapping, and the sections are read directly from it, so loading does not read
+/// the file into memory first. Single sections can be read without loading the state, e.g. to show the screen of a
+/// save state as a thumbnail (see load_screen_from_file()).
+///
+/// Files without the magic are the unversioned stream of Emulator::serialize_without_rtc() written by earlier
+/// versions.
+constexpr std::array<char, 8> save_state_magic = {'B', 'E', 'M', 'U', 'S', 'T', 'A', 'T'};
+constexpr u32 save_state_version = 2;
 
-    void write(const u8 data) { file << data; }
+#pragma pack(push, 1)
+struct FileHeader {
+    std::array<char, 8> m_magic;
+    u32 m_version;
+    u32 m_num_sections;
 };
 
-struct FileInputBuffer {
-    std::ifstream file;
+struct SectionHeader {
+    static constexpr u32 flag_compressed = 1;
 
-    u8 read() {
-        u8 data = 0;
-        file.read(reinterpret_cast<char*>(&data), 1);
-        return data;
+    u32 m_id;  ///< StateSection
+    u32 m_flags;
+    u64 m_offset;       ///< From the start of the file
+    u64 m_stored_size;  ///< In the file
+    u64 m_size;         ///< After decompressing
+    u32 m_checksum;     ///< CRC-32 of the stored bytes
+};
+#pragma pack(pop)
+
+namespace detail {
+inline u32 crc32(const std::span<const u8> data) {
+    static constexpr auto table = [] {
+        std::array<u32, 256> result{};
+        for (u32 i = 0; i < 256; ++i) {
+            u32 crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) != 0 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+            }
+            result[i] = crc;
+        }
+        return result;
+    }();
+
+    u32 crc = 0xFFFFFFFF;
+    for (const auto byte : data) {
+        crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+template <typename T>
+void append_bytes(std::vector<u8>& output, const T& value) {
+    const auto data = reinterpret_cast<const u8*>(&value);
+    output.insert(output.end(), data, data + sizeof(T));
+}
+}  // namespace detail
+
+/// A save state file, mapped into memory
+struct SaveStateFile {
+    /// Throws std::runtime_error if the file cannot be opened, or its header is invalid
+    explicit SaveStateFile(const std::string& filename) : m_file(filename) {
+        const auto data = m_file.data();
+        FileHeader header{};
+        if (data.size() < sizeof(header) ||
+            std::memcmp(data.data(), save_state_magic.data(), save_state_magic.size()) != 0) {
+            m_version = 0;
+            return;
+        }
+
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (header.m_version > save_state_version) {
+            throw std::runtime_error("Save state file " + filename + " is from a newer version");
+        }
+        m_version = header.m_version;
+
+        const auto table_size = static_cast<u64>(header.m_num_sections) * sizeof(SectionHeader);
+        if (table_size > data.size() - sizeof(header)) {
+            throw std::runtime_error("Save state file " + filename + " is truncated");
+        }
+
+        m_sections.resize(header.m_num_sections);
+        std::memcpy(m_sections.data(), data.data() + sizeof(header), table_size);
+        for (const auto& section : m_sections) {
+            if (section.m_offset > data.size() || section.m_stored_size > data.size() - section.m_offset) {
+                throw std::runtime_error("Save state file " + filename + " is truncated");
+            }
+        }
+    }
+
+    /// 0 for files written before the format was versioned, which have no sections
+    [[nodiscard]] u32 get_version() const { return m_version; }
+
+    /// The whole file, e.g. to read a file of version 0
+    [[nodiscard]] std::span<const u8> data() const { return m_file.data(); }
+
+    [[nodiscard]] bool has_section(const StateSection id) const { return find_section(id) != nullptr; }
+
+    /// Verified and decompressed contents of a section, valid until the next call
+    ///
+    /// Throws std::runtime_error if the section is missing or corrupt.
+    [[nodiscard]] std::span<const u8> read_section(const StateSection id) {
+        const auto* section = find_section(id);
+        if (section == nullptr) {
+            throw std::runtime_error("Save state file has no section " + std::to_string(static_cast<u32>(id)));
+        }
+
+        const auto stored = m_file.data().subspan(section->m_offset, section->m_stored_size);
+        if (detail::crc32(stored) != section->m_checksum) {
+            throw std::runtime_error("Save state section " + std::to_string(section->m_id) + " is corrupt");
+        }
+        if ((section->m_flags & SectionHeader::flag_compressed) == 0) {
+            return stored;
+        }
+
+        m_buffer.resize(section->m_size);
+        lz_decompress(stored, m_buffer);
+        return m_buffer;
+    }
+
+   private:
+    [[nodiscard]] const SectionHeader* find_section(const StateSection id) const {
+        for (const auto& section : m_sections) {
+            if (section.m_id == static_cast<u32>(id)) return &section;
+        }
+        return nullptr;
     }
+
+    MappedFile m_file;
+    u32 m_version = 0;
+    std::vector<SectionHeader> m_sections;
+    std::vector<u8> m_buffer;  ///< Decompressed section
+};
+
+/// Serialized, uncompressed sections of a state, in the order of state_sections. Capturing is cheap, so it can be
+/// done on the frame thread, while the file is encoded and written elsewhere (see StateFileWriter).
+struct CapturedState {
+    std::array<std::vector<u8>, std::size(state_sections)> m_sections;
 };
 
 template <typename TEmulator>
-void save_state_to_file(TEmulator& emulator, const std::string& filename) {
-    std::ofstream stream{filename, std::ios::binary};
-    auto buffer = FileOutputBuffer{std::move(stream)};
-    auto archive = StateOutputArchive{buffer};
-    emulator.serialize(archive);
+void capture_state(TEmulator& emulator, CapturedState& state) {
+    for (size_t i = 0; i < std::size(state_sections); ++i) {
+        auto& data = state.m_sections[i];
+        data.clear();
+        auto buffer = detail::SnapshotOutputBuffer{data};
+        auto archive = StateOutputArchive{buffer};
+        emulator.serialize_section(state_sections[i], archive);
+        data.resize(buffer.m_index);
+    }
+}
+
+/// Encode a save state file into output, replacing its contents. Sections are compressed where that makes them
+/// smaller.
+inline void encode_state_file(const CapturedState& state, const bool compress, std::vector<u8>& output) {
+    std::vector<SectionHeader> sections;
+    std::vector<u8> contents;
+    for (size_t i = 0; i < std::size(state_sections); ++i) {
+        const auto& serialized = state.m_sections[i];
+        auto& section = sections.emplace_back(SectionHeader{
+            .m_id = static_cast<u32>(state_sections[i]),
+            .m_flags = 0,
+            .m_offset = contents.size(),
+            .m_stored_size = serialized.size(),
+            .m_size = serialized.size(),
+            .m_checksum = 0,
+        });
+        if (compress) {
+            lz_compress(serialized, contents);
+            if (contents.size() - section.m_offset < serialized.size()) {
+                section.m_flags |= SectionHeader::flag_compressed;
+                section.m_stored_size = contents.size() - section.m_offset;
+            } else {
+                contents.resize(section.m_offset);
+            }
+        }
+        if ((section.m_flags & SectionHeader::flag_compressed) == 0) {
+            contents.insert(contents.end(), serialized.begin(), serialized.end());
+        }
+        section.m_checksum = detail::crc32(std::span{contents}.subspan(section.m_offset, section.m_stored_size));
+    }
+
+    const auto data_offset = sizeof(FileHeader) + sections.size() * sizeof(SectionHeader);
+    output.clear();
+    output.reserve(data_offset + contents.size());
+    detail::append_bytes(output, FileHeader{save_state_magic, save_state_version, static_cast<u32>(sections.size())});
+    for (auto section : sections) {
+        section.m_offset += data_offset;
+        detail::append_bytes(output, section);
+    }
+    output.insert(output.end(), contents.begin(), contents.end());
+}
+
+/// Write the state of the emulator to a file, replacing it atomically (see write_file_atomically()). Blocks until
+/// the file is on disk; use StateFileWriter to save without blocking.
+template <typename TEmulator>
+void save_state_to_file(TEmulator& emulator, const std::string& filename, const bool compress = true) {
+    CapturedState state;
+    capture_state(emulator, state);
+    std::vector<u8> file;
+    encode_state_file(state, compress, file);
+    write_file_atomically(filename, file);
 }
 
+/// Load the state of the emulator from a file. If the file is invalid, the emulator is left unchanged and
+/// std::runtime_error is thrown.
 template <typename TEmulator>
 void load_state_from_file(TEmulator& emulator, const std::string& filename) {
-    std::ifstream stream{filename, std::ios::binary};
-    auto buffer = FileInputBuffer{std::move(stream)};
+    SaveStateFile file{filename};
+
+    // Sections are verified as they are loaded, so keep the current state to restore if one is corrupt
+    Snapshot backup;
+    save_snapshot(emulator, backup);
+    try {
+        if (file.get_version() == 0) {
+            auto buffer = detail::SpanInputBuffer{file.data()};
+            auto archive = StateInputArchive{buffer};
+            emulator.serialize_without_rtc(archive);  // The clock keeps its current time, as for version 1
+            return;
+        }
+
+        for (const auto id : state_sections) {
+            if (id == StateSection::Rtc && file.get_version() < 2) {
+                continue;  // The clock keeps its current time
+            }
+
+            auto buffer = detail::SpanInputBuffer{file.read_section(id)};
+            auto archive = StateInputArchive{buffer};
+            emulator.serialize_section(id, archive);
+            if (buffer.m_index != buffer.m_data.size()) {
+                throw std::runtime_error("Save state section " + std::to_string(static_cast<u32>(id)) +
+                                         " has the wrong size");
+            }
+        }
+    } catch (...) {
+        load_snapshot(emulator, backup);
+        throw;
+    }
+}
+
+/// Read only the screen of a save state file, e.g. for a thumbnail. screen must have the size of the emulator's
+/// screen.
+///
+/// \return false if the file has no screen section (files of version 0)
+inline bool load_screen_from_file(const std::string& filename, Screen& screen) {
+    SaveStateFile file{filename};
+    if (!file.has_section(StateSection::Screen)) {
+        return false;
+    }
+
+    auto buffer = detail::SpanInputBuffer{file.read_section(StateSection::Screen)};
     auto archive = StateInputArchive{buffer};
-    emulator.serialize(archive);
+    screen.serialize(archive);
+    return true;
 }
 }  // namespace bemu::gb
@@ -0,0 +1,48 @@
+#pragma once
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#include "../gb/cartridge_header.hpp"
+#include "file.hpp"
+
+namespace bemu::gb {
+/// Hibernation: save the state when the frontend exits, and resume from it on the next start instead of booting
+///
+/// The state file is named after the cartridge's title and checksums, so each game resumes its own state, and a
+/// different ROM with the same title never loads it. Resuming maps the file and restores it directly (see
+/// load_state_from_file()), so it takes milliseconds.
+inline std::filesystem::path get_hibernation_path(const std::filesystem::path& directory,
+                                                  const CartridgeHeader& header) {
+    std::string name;
+    for (size_t i = 0; i < sizeof(header.title) && header.title[i] != '\0'; ++i) {
+        const auto c = static_cast<unsigned char>(header.title[i]);
+        name += std::isalnum(c) ? static_cast<char>(c) : '_';
+    }
+
+    char checksums[16];
+    std::snprintf(checksums, sizeof(checksums), "-%02X%04X", header.checksum, header.global_checksum);
+    return directory / (name + checksums + ".hibernate");
+}
+
+/// Restore the state saved by hibernate(), if there is one
+///
+/// \return false if there is no saved state. Throws std::runtime_error if it is invalid, leaving the emulator
+/// unchanged, so it can boot normally instead.
+template <typename TEmulator>
+bool resume_from_hibernation(TEmulator& emulator, const std::filesystem::path& path) {
+    if (!std::filesystem::exists(path)) {
+        return false;
+    }
+
+    load_state_from_file(emulator, path.string());
+    return true;
+}
+
+template <typename TEmulator>
+void hibernate(TEmulator& emulator, const std::filesystem::path& path) {
+    save_state_to_file(emulator, path.string());
+}
+}  // namespace bemu::gb
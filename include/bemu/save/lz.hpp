@@ -0,0 +1,159 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "../types.hpp"
+
+namespace bemu::gb {
+/// Fast LZ77 codec, in the spirit of LZ4, for compressing rewind history
+///
+/// The compressed data is a sequence of:
+///
+///     u8 token                       High nibble: number of literals, low nibble: match length - 4
+///     [u8 literal length...]         If the high nibble is 15: more literals, 255 means another byte follows
+///     u8 literals[]
+///     u16 offset                     Little-endian distance back to the match, 1 - 65535
+///     [u8 match length...]           If the low nibble is 15: longer match, 255 means another byte follows
+///
+/// The last sequence has literals only, and ends the data. Matches are found greedily with a hash table of the last
+/// position for each 4-byte value, which is fast and finds the repeats between similar states and screenshots.
+constexpr size_t lz_min_match = 4;
+constexpr size_t lz_max_offset = 0xFFFF;
+
+namespace detail {
+inline void write_lz_length(std::vector<u8>& output, size_t length) {
+    while (length >= 255) {
+        output.push_back(255);
+        length -= 255;
+    }
+    output.push_back(static_cast<u8>(length));
+}
+
+inline size_t read_lz_length(const std::span<const u8> input, size_t& index) {
+    size_t length = 0;
+    u8 byte = 0;
+    do {
+        if (index >= input.size()) {
+            throw std::runtime_error("LZ data truncated");
+        }
+        byte = input[index++];
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+inline u32 read_u32(const u8* data) {
+    u32 value = 0;
+    std::memcpy(&value, data, sizeof(u32));
+    return value;
+}
+}  // namespace detail
+
+/// Append the compressed input to output
+inline void lz_compress(const std::span<const u8> input, std::vector<u8>& output) {
+    constexpr size_t hash_bits = 14;
+    const auto hash = [](const u32 value) { return (value * 2654435761u) >> (32 - hash_bits); };
+
+    // Position + 1 of the last occurrence of each hashed 4-byte value, 0 if none
+    std::vector<u32> table(size_t{1} << hash_bits, 0);
+
+    size_t literal_start = 0;
+    const auto write_sequence = [&](const size_t literal_end, const size_t match_length, const size_t offset) {
+        const auto literals = literal_end - literal_start;
+        const auto match_code = match_length == 0 ? 0 : match_length - lz_min_match;
+
+        output.push_back(static_cast<u8>(std::min<size_t>(literals, 15) << 4 | std::min<size_t>(match_code, 15)));
+        if (literals >= 15) {
+            detail::write_lz_length(output, literals - 15);
+        }
+        output.insert(output.end(), input.begin() + literal_start, input.begin() + literal_end);
+
+        if (match_length != 0) {
+            output.push_back(static_cast<u8>(offset));
+            output.push_back(static_cast<u8>(offset >> 8));
+            if (match_code >= 15) {
+                detail::write_lz_length(output, match_code - 15);
+            }
+        }
+    };
+
+    size_t i = 0;
+    while (i + lz_min_match <= input.size()) {
+        const auto value = detail::read_u32(input.data() + i);
+        auto& slot = table[hash(value)];
+        const size_t candidate = slot;
+        slot = static_cast<u32>(i + 1);
+
+        if (candidate == 0 || i - (candidate - 1) > lz_max_offset ||
+            detail::read_u32(input.data() + candidate - 1) != value) {
+            ++i;
+            continue;
+        }
+
+        const auto match = candidate - 1;
+        auto length = lz_min_match;
+        while (i + length < input.size() && input[match + length] == input[i + length]) {
+            ++length;
+        }
+
+        write_sequence(i, length, i - match);
+        i += length;
+        literal_start = i;
+    }
+
+    write_sequence(input.size(), 0, 0);
+}
+
+/// Decompress input into output, which must have exactly the original size
+inline void lz_decompress(const std::span<const u8> input, const std::span<u8> output) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < input.size()) {
+        const auto token = input[in++];
+
+        auto literals = static_cast<size_t>(token >> 4);
+        if (literals == 15) {
+            literals += detail::read_lz_length(input, in);
+        }
+        if (in + literals > input.size() || out + literals > output.size()) {
+            throw std::runtime_error("LZ literals out of bounds");
+        }
+        std::memcpy(output.data() + out, input.data() + in, literals);
+        in += literals;
+        out += literals;
+
+        if (in == input.size()) break;
+
+        if (in + 2 > input.size()) {
+            throw std::runtime_error("LZ data truncated");
+        }
+        const auto offset = static_cast<size_t>(input[in] | input[in + 1] << 8);
+        in += 2;
+
+        auto length = static_cast<size_t>(token & 0xF) + lz_min_match;
+        if ((token & 0xF) == 15) {
+            length += detail::read_lz_length(input, in);
+        }
+        if (offset == 0 || offset > out || out + length > output.size()) {
+            throw std::runtime_error("LZ match out of bounds");
+        }
+
+        if (offset >= length) {
+            std::memcpy(output.data() + out, output.data() + out - offset, length);
+        } else {
+            // Overlapping match, e.g. a run of one repeated byte
+            for (size_t j = 0; j < length; ++j) {
+                output[out + j] = output[out + j - offset];
+            }
+        }
+        out += length;
+    }
+
+    if (out != output.size()) {
+        throw std::runtime_error("LZ output size mismatch");
+    }
+}
+}  // namespace bemu::gb
@@ -0,0 +1,128 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "../types.hpp"
+
+namespace bemu::gb {
+namespace detail {
+/// Fast 64-bit hash of one page, a word at a time. Not cryptographic: equal hashes are confirmed by comparing the data.
+inline u64 hash_page(const std::span<const u8> data) {
+    u64 hash = 0x9E3779B97F4A7C15 ^ data.size();
+    const auto mix = [&](const u64 word) {
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9;
+        hash ^= hash >> 31;
+    };
+
+    size_t i = 0;
+    for (; i + sizeof(u64) <= data.size(); i += sizeof(u64)) {
+        u64 word = 0;
+        std::memcpy(&word, data.data() + i, sizeof(u64));
+        mix(word);
+    }
+    for (; i < data.size(); ++i) {
+        mix(data[i]);
+    }
+    return hash;
+}
+}  // namespace detail
+
+/// Content-addressed storage of fixed-size pages, shared by reference between save states
+///
+/// store() splits a state into pages and stores each distinct page once, so states which are mostly identical (e.g.
+/// the full states starting consecutive rewind buckets) only cost the pages which changed, plus one PageId per page.
+/// Pages are reference counted: each id returned by store() holds one reference, returned with release().
+struct PageStore {
+    static constexpr size_t page_size = 256;
+    using PageId = u32;
+
+    /// Store data, appending the ids of its pages to ids. The last page is padded with zeros.
+    void store(const std::span<const u8> data, std::vector<PageId>& ids) {
+        for (size_t offset = 0; offset < data.size(); offset += page_size) {
+            std::array<u8, page_size> page{};
+            const auto size = std::min(page_size, data.size() - offset);
+            std::memcpy(page.data(), data.data() + offset, size);
+            ids.push_back(intern(page));
+        }
+    }
+
+    /// Reassemble size bytes stored with store() into output, replacing its contents
+    void load(const std::span<const PageId> ids, const size_t size, std::vector<u8>& output) const {
+        if (size > ids.size() * page_size) {
+            throw std::invalid_argument("Not enough pages for the size");
+        }
+
+        output.resize(size);
+        for (size_t i = 0; i < ids.size() && i * page_size < size; ++i) {
+            std::memcpy(output.data() + i * page_size, m_pages[ids[i]].m_data.data(),
+                        std::min(page_size, size - i * page_size));
+        }
+    }
+
+    /// Drop one reference to each of the pages, freeing those which are no longer used
+    void release(const std::span<const PageId> ids) {
+        for (const auto id : ids) {
+            auto& page = m_pages[id];
+            if (--page.m_refs != 0) continue;
+
+            const auto [begin, end] = m_index.equal_range(page.m_hash);
+            m_index.erase(std::find_if(begin, end, [&](const auto& entry) { return entry.second == id; }));
+            m_free.push_back(id);
+            --m_num_pages;
+        }
+    }
+
+    void clear() {
+        m_pages.clear();
+        m_free.clear();
+        m_index.clear();
+        m_num_pages = 0;
+    }
+
+    /// Number of distinct pages in use
+    [[nodiscard]] size_t get_num_pages() const { return m_num_pages; }
+    [[nodiscard]] size_t get_used_bytes() const { return m_num_pages * sizeof(Page); }
+
+   private:
+    struct Page {
+        std::array<u8, page_size> m_data;
+        u64 m_hash;
+        u32 m_refs;
+    };
+
+    PageId intern(const std::array<u8, page_size>& data) {
+        const auto hash = detail::hash_page(data);
+        const auto [begin, end] = m_index.equal_range(hash);
+        for (auto it = begin; it != end; ++it) {
+            auto& page = m_pages[it->second];
+            if (page.m_data == data) {
+                ++page.m_refs;
+                return it->second;
+            }
+        }
+
+        PageId id = 0;
+        if (m_free.empty()) {
+            id = static_cast<PageId>(m_pages.size());
+            m_pages.emplace_back();
+        } else {
+            id = m_free.back();
+            m_free.pop_back();
+        }
+        m_pages[id] = Page{data, hash, 1};
+        m_index.emplace(hash, id);
+        ++m_num_pages;
+        return id;
+    }
+
+    std::vector<Page> m_pages;  ///< Indexed by PageId, including free ones
+    std::vector<PageId> m_free;
+    std::unordered_multimap<u64, PageId> m_index;  ///< Hash to the pages with that hash
+    size_t m_num_pages = 0;
+};
+}  // namespace bemu::gb
@@ -1,18 +1,33 @@
 #pragma once
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <span>
+#include <stdexcept>
 #include <vector>
 
+#include "../gb/clock.hpp"
 #include "../screen.hpp"
+#include "delta.hpp"
+#include "page_store.hpp"
+#include "rewind_compressor.hpp"
 #include "save_state.hpp"
+#include "snapshot.hpp"
 
 namespace bemu::gb {
 
 namespace detail {
+/// Appends to a vector. Reserve the exact size first (see get_serialized_size()) to avoid reallocations.
 struct VectorOutputBuffer {
     std::vector<u8>& m_buffer;
 
     void write(const u8 data) { m_buffer.push_back(data); }
+    void write_bytes(const std::span<const u8> data) { m_buffer.insert(m_buffer.end(), data.begin(), data.end()); }
 };
 
 struct VectorInputBuffer {
@@ -21,270 +36,911 @@ struct VectorInputBuffer {
 
     u8 read() { return m_buffer[m_index++]; }
 
-    operator bool() const { return m_index < m_buffer.size(); }
-};
-
-/// Stores a (start, length, data) of bytes
-struct DiffEntry {
-    u32 m_start;
-    u8 m_length;
-    std::vector<u8> m_data;
-
-    void save(auto& ar) const {
-        ar(m_start);
-        ar(m_length);
-        for (const auto& byte : m_data) {
-            ar(byte);
-        }
-    }
-
-    void load(auto& ar) {
-        ar(m_start);
-        ar(m_length);
-        m_data.resize(m_length);
-        for (auto& byte : m_data) {
-            ar(byte);
+    void read_bytes(const std::span<u8> data) {
+        if (m_index + data.size() > m_buffer.size()) {
+            throw std::runtime_error("Inconsistent state sizes");
         }
+        std::memcpy(data.data(), m_buffer.data() + m_index, data.size());
+        m_index += data.size();
     }
 
-    [[nodiscard]] bool contains(const size_t i) const { return i >= m_start && i < m_start + m_length; }
-    [[nodiscard]] u32 last_index() const { return m_start + m_length - 1; }
+    operator bool() const { return m_index < m_buffer.size(); }
 };
 
-/// Writes the diff between a base buffer and new data
-struct VectorDiffOutputBuffer {
-    /// Base bytes to compare against
-    ///
-    /// Diffs are calculated against this buffer
-    const std::vector<u8>& m_base;
-
-    /// Encoded diff output, sequence of DiffEntry
-    std::vector<u8>& m_output;
-
-    /// Next byte being compared against m_base
-    size_t m_base_index = 0;
-
-    /// Current diff being evaluated
-    std::optional<DiffEntry> m_current_entry;
-
-    void write(const u8 data) {
-        if (m_base_index >= m_base.size()) {
-            throw std::runtime_error("Inconsistent state sizes");
-        }
-
-        const auto existing = m_base[m_base_index++];
-
-        if (existing != data) {
-            if (m_current_entry) {
-                m_current_entry->m_length++;
-                m_current_entry->m_data.push_back(data);
-                if (m_current_entry->m_length == 0xFF) {
-                    write_entry();
+/// Pack the 2-bit pixels of a screen, 4 per byte, continuing across rows
+inline void pack_screen(const Screen& screen, std::vector<u8>& output) {
+    output.assign((screen.get_width() * screen.get_height() + 3) / 4, 0);
+
+    u8* out = output.data();
+    size_t pending = 0;  // Pixels already in *out
+    for (const auto& row : screen.m_pixels) {
+        const u8* pixels = row.data();
+        size_t x = 0;
+        if (pending == 0) {
+            if constexpr (std::endian::native == std::endian::little) {
+                // 8 pixels at a time: gather the low 2 bits of each byte into 2 bytes
+                for (; x + 8 <= row.size(); x += 8) {
+                    u64 word = 0;
+                    std::memcpy(&word, pixels + x, sizeof(word));
+                    word &= 0x0303030303030303;
+                    word = (word | word >> 6) & 0x000F000F000F000F;
+                    word = (word | word >> 12) & 0x000000FF000000FF;
+                    *out++ = static_cast<u8>(word);
+                    *out++ = static_cast<u8>(word >> 32);
                 }
-            } else {
-                m_current_entry.emplace();
-                m_current_entry->m_start = m_base_index - 1;
-                m_current_entry->m_length = 1;
-                m_current_entry->m_data.push_back(data);
             }
-        } else if (m_current_entry) {
-            write_entry();
+            for (; x + 4 <= row.size(); x += 4) {
+                *out++ = static_cast<u8>((pixels[x] & 0b11) | (pixels[x + 1] & 0b11) << 2 |
+                                         (pixels[x + 2] & 0b11) << 4 | (pixels[x + 3] & 0b11) << 6);
+            }
+        }
+        for (; x < row.size(); ++x) {
+            *out |= static_cast<u8>((pixels[x] & 0b11) << (pending * 2));
+            if (++pending == 4) {
+                ++out;
+                pending = 0;
+            }
         }
     }
+}
 
-    void write_entry() {
-        if (!m_current_entry) return;
-
-        VectorOutputBuffer buffer{m_output};
-        StateOutputArchive archive{buffer};
-        m_current_entry->save(archive);
-
-        m_current_entry.reset();
+inline void unpack_screen(const std::span<const u8> packed, Screen& screen) {
+    if (packed.size() != (screen.get_width() * screen.get_height() + 3) / 4) {
+        throw std::invalid_argument("Screenshot size does not match the screen");
     }
-};
-
-/// Combines a base buffer and a diff buffer to reconstruct the full data
-struct VectorDiffInputBuffer {
-    VectorInputBuffer m_base_buffer;
-    VectorInputBuffer m_diff_buffer;
-    std::optional<DiffEntry> m_current_entry;
-
-    VectorDiffInputBuffer(std::vector<u8>& base, std::vector<u8>& diff_buffer)
-        : m_base_buffer(base), m_diff_buffer(diff_buffer) {}
-
-    u8 read() {
-        const auto i = m_base_buffer.m_index;
-        const auto base = m_base_buffer.read();
-
-        // Load next entry if needed
-        read_entry();
-
-        // Inside current entry
-        if (m_current_entry && m_current_entry->contains(i)) {
-            const auto offset = i - m_current_entry->m_start;
-            const auto result = m_current_entry->m_data[offset];
 
-            // End of current entry
-            if (i == m_current_entry->last_index()) {
-                m_current_entry.reset();
+    const u8* in = packed.data();
+    size_t consumed = 0;  // Pixels already taken from *in
+    for (auto& row : screen.m_pixels) {
+        u8* pixels = row.data();
+        size_t x = 0;
+        if (consumed == 0) {
+            if constexpr (std::endian::native == std::endian::little) {
+                // 8 pixels at a time: spread 2 bytes into the low 2 bits of each byte
+                for (; x + 8 <= row.size(); x += 8) {
+                    u64 word = in[0] | static_cast<u64>(in[1]) << 32;
+                    word = (word | word << 12) & 0x000F000F000F000F;
+                    word = (word | word << 6) & 0x0303030303030303;
+                    std::memcpy(pixels + x, &word, sizeof(word));
+                    in += 2;
+                }
+            }
+            for (; x + 4 <= row.size(); x += 4) {
+                const auto byte = *in++;
+                pixels[x] = byte & 0b11;
+                pixels[x + 1] = byte >> 2 & 0b11;
+                pixels[x + 2] = byte >> 4 & 0b11;
+                pixels[x + 3] = byte >> 6;
             }
-
-            return result;
         }
-
-        return base;
-    }
-
-    void read_entry() {
-        if (!m_current_entry && m_diff_buffer) {
-            StateInputArchive archive{m_diff_buffer};
-            m_current_entry.emplace();
-            m_current_entry->load(archive);
+        for (; x < row.size(); ++x) {
+            pixels[x] = *in >> (consumed * 2) & 0b11;
+            if (++consumed == 4) {
+                ++in;
+                consumed = 0;
+            }
         }
     }
-};
+}
 }  // namespace detail
 
+/// Density of the rewind history beyond a given age
+struct RetentionTier {
+    double m_min_age_seconds;  ///< Emulated time since the state was captured
+    size_t m_stride;           ///< Only every m_stride-th captured state is kept
+};
+
 /// Storage for rewind states
 ///
 /// Save states are stored in buckets, each bucket containing a number of frames. By default, 60 frames are stored per
 /// bucket (1 second at 60fps), up to 256 MB of memory or 100'000 buckets (about 24 hours).
 ///
 /// Each bucket consists of a set of states. The first state in each bucket is a full save state, while subsequent
-/// states are stored as diffs from the first state. This allows for efficient storage of multiple states while
-/// minimizing memory usage.
+/// states are stored as deltas from the first state (see encode_delta()). This allows for efficient storage of multiple
+/// states while minimizing memory usage. The full states are split into pages in a PageStore, so each bucket only
+/// stores the pages which changed since any other bucket, and the ids of its pages. If the emulator tracks dirty pages
+/// (see Emulator::m_dirty_pages), a delta only compares the pages written since the first state was stored.
+/// Screenshots for previewing are packed at 2 bits per pixel and stored the same way, as deltas from the bucket's first
+/// screenshot.
+///
+/// The newest hot_buckets buckets are kept uncompressed in one ring buffer of max_bytes, in push order. When a new
+/// state does not fit, whole buckets are evicted from the oldest end, so pushing costs the same whether the history is
+/// empty or full. The memory is reserved up front but only committed by the OS as it is first written.
+///
+/// Older buckets are copied out of the ring buffer and compressed on a worker thread (see RewindCompressor). When
+/// popping gets close to them, they are decompressed ahead of time on the worker, so pop_state() does not wait for the
+/// decompression as long as states are popped no faster than about one bucket per hot window.
+///
+/// Older history is thinned out according to the retention tiers (see default_retention()): when a bucket leaves the
+/// hot window, and again as it crosses the age of each tier. Within a bucket, the full state and every m_stride-th
+/// delta are kept, and the rest is compacted away on the worker. Strides longer than a bucket keep one in every
+/// m_stride / frames_in_bucket buckets whole.
 template <class TEmulator>
 struct Rewind {
     explicit Rewind(TEmulator& emulator, const size_t max_bytes = 256 * 1024 * 1024, const size_t max_buckets = 100'000,
-                    const size_t frames_in_bucket = 60)
+                    const size_t frames_in_bucket = 60, const size_t hot_buckets = 3)
         : m_emulator(emulator),
           m_max_bytes(max_bytes),
           m_max_buckets(max_buckets),
-          m_frames_in_bucket(frames_in_bucket) {
-        if (m_max_bytes == 0 || m_max_buckets == 0 || m_frames_in_bucket == 0) {
+          m_frames_in_bucket(frames_in_bucket),
+          m_hot_buckets(hot_buckets) {
+        if (m_max_bytes == 0 || m_max_buckets == 0 || m_frames_in_bucket == 0 || m_hot_buckets == 0) {
             throw std::invalid_argument("Rewind parameters must be greater than 0");
         }
+        m_arena = std::make_unique_for_overwrite<u8[]>(m_max_bytes);
     }
 
-    [[nodiscard]] size_t get_max_bytes() const { return m_max_bytes; }
+    Rewind(const Rewind&) = delete;
+    Rewind& operator=(const Rewind&) = delete;
 
-    [[nodiscard]] size_t get_used_bytes() const {
-        size_t result = 0;
-        for (const auto& bucket : m_buckets) {
-            for (const auto& state : bucket.m_states) {
-                result += state.m_data.size();
+    /// Every frame for the hot window, every 4th frame up to a minute, every 30th up to 10 minutes, and every 300th
+    /// (one full state per 5 seconds) beyond that
+    [[nodiscard]] static std::vector<RetentionTier> default_retention() {
+        return {{0.0, 4}, {60.0, 30}, {600.0, 300}};
+    }
+
+    /// Set the retention tiers, in increasing order of age and stride. Empty keeps every state.
+    ///
+    /// Buckets which were already thinned are not affected by a lower stride.
+    void set_retention(std::vector<RetentionTier> tiers) {
+        for (size_t i = 0; i < tiers.size(); ++i) {
+            if (tiers[i].m_stride == 0 ||
+                (i > 0 && (tiers[i].m_min_age_seconds < tiers[i - 1].m_min_age_seconds ||
+                           tiers[i].m_stride < tiers[i - 1].m_stride))) {
+                throw std::invalid_argument("Retention tiers must be in increasing order, with strides above 0");
             }
         }
-        return result;
+        m_retention = std::move(tiers);
     }
 
-    [[nodiscard]] size_t get_num_states() const {
-        size_t result = 0;
-        for (const auto& bucket : m_buckets) {
-            result += bucket.m_states.size();
+    /// Store a screenshot with each state, for previewing the timeline with get_screenshot(). Without them, the frame
+    /// of a state is only available by loading it, since the screen is part of the state.
+    void set_store_screenshots(const bool store) { m_store_screenshots = store; }
+
+    /// Only capture every Nth pushed frame, e.g. while fast-forwarding
+    void set_capture_interval(const size_t frames) {
+        if (frames == 0) {
+            throw std::invalid_argument("Capture interval must be greater than 0");
         }
-        return result;
+        m_capture_interval = frames;
+        m_frames_until_capture = std::min(m_frames_until_capture, frames - 1);
+    }
+
+    [[nodiscard]] size_t get_max_bytes() const { return m_max_bytes; }
+    [[nodiscard]] size_t get_used_bytes() const {
+        return m_hot_bytes + m_cold_bytes + m_page_store.get_used_bytes();
     }
+    [[nodiscard]] size_t get_num_states() const { return m_states.size() + m_num_cold_states; }
 
     [[nodiscard]] bool is_at_capacity() const {
-        return get_used_bytes() >= m_max_bytes || m_buckets.size() >= m_max_buckets;
+        return get_used_bytes() >= m_max_bytes || m_num_buckets >= m_max_buckets;
     }
     [[nodiscard]] size_t get_first_ticks() const {
-        if (m_buckets.empty() || m_buckets.front().m_states.empty()) {
+        if (!m_cold.empty()) {
+            return m_cold.front().m_states.front().m_ticks;
+        }
+        if (m_states.empty()) {
             return m_emulator.get_tick_count();
         }
-        return m_buckets.front().m_states.front().m_ticks;
+        return m_states.front().m_ticks;
+    }
+    [[nodiscard]] size_t get_last_ticks() const {
+        if (get_num_states() == 0) {
+            return m_emulator.get_tick_count();
+        }
+        return get_newest_state().m_ticks;
     }
 
-    void push_state(std::chrono::system_clock::time_point now = std::chrono::system_clock::now()) {
-        auto& bucket = prepare_bucket();
-        auto& state = bucket.m_states.emplace_back();
-        state.m_wall_time = now;
-        state.m_ticks = m_emulator.get_tick_count();
-        state.m_screenshot = m_emulator.get_screen();
-
-        if (bucket.m_states.size() == 1) {
-            // First state in bucket, save full state
-            auto buffer = detail::VectorOutputBuffer{state.m_data};
-            auto archive = StateOutputArchive{buffer};
-            m_emulator.serialize(archive);
-        } else {
-            // Save diff from base state
-            auto& base_state = bucket.m_states.front();
+    /// Tick count of the state loaded by the last seek, while the timeline is being scrubbed
+    [[nodiscard]] std::optional<u64> get_cursor_ticks() const { return m_cursor_ticks; }
 
-            auto buffer = detail::VectorDiffOutputBuffer{base_state.m_data, state.m_data};
-            auto archive = StateOutputArchive{buffer};
-            m_emulator.serialize(archive);
-            buffer.write_entry();  // Flush any remaining diff data
-        }
+    /// Load the newest state captured at or before the given tick count, or the oldest state if there is none
+    ///
+    /// Unlike pop_state(), this keeps the newer states, so the timeline can be scrubbed back and forth. They are
+    /// discarded by the next push_state() (playing on from the loaded state) or pop_state(). Finding the state takes
+    /// O(log n), followed by decoding one state, and decompressing its bucket if it is not in the hot window.
+    ///
+    /// \return false if there are no states
+    bool seek_to_ticks(const u64 ticks) {
+        return seek(ticks, &State::m_ticks);
+    }
 
-        free_space();
+    /// Load the newest state captured at or before the given wall clock time, like seek_to_ticks()
+    bool seek_to_time(const std::chrono::system_clock::time_point time) {
+        return seek(time, &State::m_wall_time);
     }
 
-    bool pop_state() {
-        if (m_buckets.empty()) {
+    /// Decode the screenshot of the newest state captured at or before the given tick count (or the oldest state),
+    /// without loading the state. screen must have the size of the emulator's screen.
+    ///
+    /// \return false if there are no states, or the state has no screenshot (see set_store_screenshots())
+    bool get_screenshot(const u64 ticks, Screen& screen) {
+        receive_results();
+
+        const auto position = find_state(ticks, &State::m_ticks);
+        if (!position || get_state(*position).m_screenshot_size == 0) {
             return false;
         }
 
-        auto& bucket = m_buckets.back();
+        const auto& state = get_state(*position);
+        const auto* records = position->m_bucket ? get_raw(*position->m_bucket) : m_arena.get();
+        const auto& base = position->m_bucket ? m_cold[*position->m_bucket].m_states.front()
+                                              : get_bucket_base(position->m_index);
+        auto screenshot = get_screenshot_data(records, state);
+        if (state.m_index_in_bucket != 0) {
+            decode_delta(get_screenshot_data(records, base), screenshot, m_packed_screen);
+            screenshot = m_packed_screen;
+        }
+        detail::unpack_screen(screenshot, screen);
 
-        // Load ful state
-        if (bucket.m_states.size() == 1) {
-            auto buffer = detail::VectorInputBuffer{bucket.m_states.front().m_data};
-            auto archive = StateInputArchive{buffer};
-            m_emulator.serialize(archive);
+        if (position->m_bucket && !wants_raw(*position->m_bucket)) {
+            release_raw(m_cold[*position->m_bucket]);
+        }
+        return true;
+    }
+
+    void push_state(std::chrono::system_clock::time_point now = std::chrono::system_clock::now()) {
+        receive_results();
+
+        // Playing on after a seek: the states after the loaded one belong to the abandoned timeline
+        if (m_cursor_ticks) {
+            discard_states_from(*m_cursor_ticks + 1);
+        }
 
-            // Remove entire bucket
-            m_buckets.pop_back();
+        if (m_frames_until_capture > 0) {
+            --m_frames_until_capture;
+            return;
+        }
+        m_frames_until_capture = m_capture_interval - 1;
+
+        // Serialize into a reused scratch buffer, then copy into the arena at the final size. The states never leave
+        // memory, so they can use the faster snapshot layout.
+        m_scratch.clear();
+        auto buffer = detail::VectorOutputBuffer{m_scratch};
+        auto archive = StateOutputArchive{buffer};
+        detail::serialize_snapshot(m_emulator, archive);
+
+        std::span<const u8> screenshot;
+        if (m_store_screenshots) {
+            detail::pack_screen(m_emulator.get_screen(), m_packed_screen);
+            screenshot = m_packed_screen;
+        }
+
+        // Either start a new bucket with a full state, or store a delta from the current bucket's first state. The
+        // screenshot is stored the same way.
+        bool full = m_states.empty() || m_states.back().m_index_in_bucket + 1 >= m_frames_in_bucket;
+        std::span<const u8> data;
+        const auto store_full_state = [&] {
+            full = true;
+            m_full_state_ids.clear();
+            m_page_store.store(m_scratch, m_full_state_ids);
+            write_full_state(m_scratch.size(), m_full_state_ids, m_full_state);
+            data = m_full_state;
+        };
+
+        if (full) {
+            store_full_state();
         } else {
-            // Load diff state
-            auto& base = bucket.m_states.front();
-            auto& state = bucket.m_states.back();
+            // Only the pages written since the base was stored can differ from it
+            const auto& base = get_bucket_base(m_states.size() - 1);
+            load_base(m_arena.get(), base);
+            detail::get_dirty_snapshot_ranges(m_emulator, m_dirty_ranges);
+            m_delta.clear();
+            encode_delta(m_base, m_scratch, m_delta, m_dirty_ranges);
+            data = m_delta;
+
+            if (m_store_screenshots) {
+                m_screenshot_delta.clear();
+                encode_delta(get_screenshot_data(m_arena.get(), base), m_packed_screen, m_screenshot_delta);
+                screenshot = m_screenshot_delta;
+            }
+        }
+
+        if (full) {
+            while (m_num_buckets >= m_max_buckets) {
+                evict_oldest_bucket();
+            }
+        }
+
+        auto offset = find_space(screenshot.size() + data.size());
+        while (!offset) {
+            if (m_states.empty() && m_cold.empty()) {
+                // Larger than the whole budget
+                if (full) {
+                    release_pages(m_full_state_ids);
+                }
+                return;
+            }
+
+            evict_oldest_bucket();
+            if (m_states.empty() && !full) {
+                // The base of the delta was evicted as well
+                store_full_state();
+                screenshot = m_store_screenshots ? std::span<const u8>{m_packed_screen} : std::span<const u8>{};
+            }
+            offset = find_space(screenshot.size() + data.size());
+        }
 
-            auto buffer = detail::VectorDiffInputBuffer{base.m_data, state.m_data};
-            auto archive = StateInputArchive{buffer};
-            m_emulator.serialize(archive);
+        auto* dest = m_arena.get() + *offset;
+        std::memcpy(dest, screenshot.data(), screenshot.size());
+        std::memcpy(dest + screenshot.size(), data.data(), data.size());
+
+        m_states.push_back(State{
+            .m_wall_time = now,
+            .m_ticks = m_emulator.get_tick_count(),
+            .m_offset = *offset,
+            .m_screenshot_size = screenshot.size(),
+            .m_data_size = data.size(),
+            .m_index_in_bucket = full ? 0 : m_states.back().m_index_in_bucket + 1,
+        });
+        m_hot_bytes += m_states.back().get_size();
+        if (full) {
+            ++m_num_buckets;
+            ++m_num_hot_buckets;
+            detail::clear_dirty_pages(m_emulator);
+        }
+
+        // Playing again after rewinding into the compressed history: its decompressed copies are no longer needed
+        for (size_t i = m_cold.size() - std::min<size_t>(m_cold.size(), 2); i < m_cold.size(); ++i) {
+            if (!wants_raw(i)) {
+                release_raw(m_cold[i]);
+            }
+        }
 
-            // Remove last state
-            bucket.m_states.pop_back();
+        while (m_num_hot_buckets > m_hot_buckets) {
+            move_oldest_hot_bucket_to_cold();
+        }
+        thin_history();
+    }
+
+    bool pop_state() {
+        receive_results();
+        m_frames_until_capture = 0;  // Capture the first frame after rewinding
+
+        // Rewinding from a seek: the loaded state is consumed, as if it had been popped
+        if (m_cursor_ticks) {
+            discard_states_from(*m_cursor_ticks);
+        }
+
+        if (get_num_states() == 0) {
+            return false;
+        }
+
+        if (m_states.empty()) {
+            load(Position{m_cold.size() - 1, m_cold.back().m_states.size() - 1});
+        } else {
+            load(Position{std::nullopt, m_states.size() - 1});
         }
+        discard_newest_state();
 
+        prefetch();
         return true;
     }
 
-    void clear() { m_buckets.clear(); }
+    void clear() {
+        while (m_num_pending_jobs > 0) {
+            apply_result(m_compressor.wait());
+        }
+
+        m_states.clear();
+        m_cold.clear();
+        m_page_store.clear();
+        m_base_ids.clear();
+        m_cursor_ticks.reset();
+        m_hot_bytes = 0;
+        m_cold_bytes = 0;
+        m_num_cold_states = 0;
+        m_num_buckets = 0;
+        m_num_hot_buckets = 0;
+    }
 
    private:
+    /// Location of a state in the arena, or in the records of a cold bucket: the screenshot, followed by the full state
+    /// (see write_full_state()) or delta
     struct State {
         std::chrono::system_clock::time_point m_wall_time;
         u64 m_ticks;
-        Screen m_screenshot;
-        std::vector<u8> m_data;
+        size_t m_offset;
+        size_t m_screenshot_size;
+        size_t m_data_size;
+        size_t m_index_in_bucket;  ///< 0 for the full state starting a bucket
+
+        [[nodiscard]] size_t get_size() const { return m_screenshot_size + m_data_size; }
+    };
+
+    /// A bucket which left the hot window
+    struct ColdBucket {
+        u64 m_id = 0;
+        std::vector<State> m_states;   ///< Oldest first, with offsets into the decompressed records
+        size_t m_raw_size = 0;         ///< Size of the decompressed records
+        std::vector<u8> m_raw;         ///< Decompressed records while being compressed or about to be popped, or empty
+        std::vector<u8> m_compressed;  ///< Empty until compressed
+        size_t m_pending_jobs = 0;     ///< Jobs on the worker, which read m_raw or m_compressed
+        size_t m_stride = 1;           ///< Retention stride, see apply_thinning()
+        std::vector<PageStore::PageId> m_page_ids;  ///< Of the full state, released with the bucket
+
+        [[nodiscard]] size_t get_size() const {
+            return m_raw.size() + m_compressed.size() + m_page_ids.size() * sizeof(PageStore::PageId);
+        }
     };
 
-    struct Bucket {
-        std::vector<State> m_states;
+    /// Location of a state: in a cold bucket, or in the hot states if m_bucket is empty
+    struct Position {
+        std::optional<size_t> m_bucket;
+        size_t m_index;
     };
 
-    /// Free up som space by removing the oldest buckets
-    void free_space() {
-        while (is_at_capacity()) {
-            m_buckets.erase(m_buckets.begin());
+    [[nodiscard]] const State& get_newest_state() const {
+        return m_states.empty() ? m_cold.back().m_states.back() : m_states.back();
+    }
+
+    /// Position of the newest state with key(state) <= value, or of the oldest state if there is none
+    template <class T, class TKey>
+    [[nodiscard]] std::optional<Position> find_state(const T& value, const TKey key) const {
+        const auto is_before = [&](const State& state) { return std::invoke(key, state) <= value; };
+
+        if (!m_states.empty() && (is_before(m_states.front()) || m_cold.empty())) {
+            const auto it = std::ranges::partition_point(m_states, is_before);
+            const auto index = static_cast<size_t>(std::max<std::ptrdiff_t>(it - m_states.begin() - 1, 0));
+            return Position{std::nullopt, index};
+        }
+        if (m_cold.empty()) {
+            return std::nullopt;
         }
+
+        const auto bucket_it = std::ranges::partition_point(
+            m_cold, [&](const ColdBucket& bucket) { return is_before(bucket.m_states.front()); });
+        const auto bucket = static_cast<size_t>(std::max<std::ptrdiff_t>(bucket_it - m_cold.begin() - 1, 0));
+        const auto& states = m_cold[bucket].m_states;
+        const auto it = std::ranges::partition_point(states, is_before);
+        return Position{bucket, static_cast<size_t>(std::max<std::ptrdiff_t>(it - states.begin() - 1, 0))};
     }
 
-    /// Returns [base state, new state]
-    Bucket& prepare_bucket() {
-        if (m_buckets.empty() || m_buckets.back().m_states.size() >= m_frames_in_bucket) {
-            return m_buckets.emplace_back();
+    template <class T, class TKey>
+    bool seek(const T& value, const TKey key) {
+        receive_results();
+
+        const auto position = find_state(value, key);
+        if (!position) {
+            return false;
+        }
+
+        // Set before loading, so the bucket is kept decompressed
+        const auto previous = m_cursor_ticks ? find_state(*m_cursor_ticks, &State::m_ticks) : std::nullopt;
+        m_cursor_ticks = get_state(*position).m_ticks;
+        m_frames_until_capture = 0;
+        load(*position);
+
+        // Free the bucket decompressed for the previous seek, unless it is still needed
+        if (previous && previous->m_bucket && previous->m_bucket != position->m_bucket &&
+            !wants_raw(*previous->m_bucket)) {
+            release_raw(m_cold[*previous->m_bucket]);
+        }
+        return true;
+    }
+
+    [[nodiscard]] const State& get_state(const Position& position) const {
+        return position.m_bucket ? m_cold[*position.m_bucket].m_states[position.m_index] : m_states[position.m_index];
+    }
+
+    void load(const Position& position) {
+        if (!position.m_bucket) {
+            load_state(m_arena.get(), get_bucket_base(position.m_index), m_states[position.m_index]);
+            return;
+        }
+
+        const auto& bucket = m_cold[*position.m_bucket];
+        load_state(get_raw(*position.m_bucket), bucket.m_states.front(), bucket.m_states[position.m_index]);
+    }
+
+    /// Decompressed records of a cold bucket, waiting for the worker if they are not ready
+    const u8* get_raw(const size_t index) {
+        auto& bucket = m_cold[index];
+        m_loading_bucket = bucket.m_id;
+        while (bucket.m_raw.empty()) {
+            // Not prefetched in time
+            if (bucket.m_pending_jobs == 0) {
+                submit(bucket, RewindCompressor::JobType::Decompress);
+            }
+            apply_result(m_compressor.wait());
+        }
+        m_loading_bucket.reset();
+        return bucket.m_raw.data();
+    }
+
+    void discard_newest_state() {
+        if (m_states.empty()) {
+            m_cold.back().m_states.pop_back();
+            --m_num_cold_states;
+            if (m_cold.back().m_states.empty()) {
+                remove_cold_bucket(m_cold.size() - 1);
+            }
+            return;
+        }
+
+        if (m_states.back().m_index_in_bucket == 0) {
+            release_full_state(m_states.back());
+            --m_num_buckets;
+            --m_num_hot_buckets;
+        }
+        m_hot_bytes -= m_states.back().get_size();
+        m_states.pop_back();
+    }
+
+    /// Remove the states captured at or after the given tick count, and stop scrubbing
+    void discard_states_from(const u64 ticks) {
+        m_cursor_ticks.reset();
+        while (get_num_states() != 0 && get_newest_state().m_ticks >= ticks) {
+            discard_newest_state();
+        }
+    }
+
+    [[nodiscard]] static std::span<const u8> get_screenshot_data(const u8* records, const State& state) {
+        return {records + state.m_offset, state.m_screenshot_size};
+    }
+
+    [[nodiscard]] static std::span<const u8> get_data(const u8* records, const State& state) {
+        return {records + state.m_offset + state.m_screenshot_size, state.m_data_size};
+    }
+
+    [[nodiscard]] const State& get_bucket_base(const size_t index) const {
+        return m_states[index - m_states[index].m_index_in_bucket];
+    }
+
+    /// Full states are stored as their size, followed by the ids of their pages in m_page_store
+    static void write_full_state(const u64 size, const std::span<const PageStore::PageId> ids,
+                                 std::vector<u8>& output) {
+        output.resize(sizeof(size) + ids.size_bytes());
+        std::memcpy(output.data(), &size, sizeof(size));
+        std::memcpy(output.data() + sizeof(size), ids.data(), ids.size_bytes());
+    }
+
+    /// Size and page ids of a full state, see write_full_state()
+    static u64 read_full_state(const u8* records, const State& state, std::vector<PageStore::PageId>& ids) {
+        const auto data = get_data(records, state);
+        u64 size = 0;
+        std::memcpy(&size, data.data(), sizeof(size));
+        ids.resize((data.size() - sizeof(size)) / sizeof(PageStore::PageId));
+        std::memcpy(ids.data(), data.data() + sizeof(size), ids.size() * sizeof(PageStore::PageId));
+        return size;
+    }
+
+    void load_full_state(const u8* records, const State& state, std::vector<u8>& output) {
+        const auto size = read_full_state(records, state, m_page_ids);
+        m_page_store.load(m_page_ids, size, output);
+    }
+
+    /// Load a full state into m_base, unless it is already there
+    void load_base(const u8* records, const State& state) {
+        const auto size = read_full_state(records, state, m_page_ids);
+        if (size == m_base.size() && m_page_ids == m_base_ids) return;
+
+        m_page_store.load(m_page_ids, size, m_base);
+        m_base_ids = m_page_ids;
+    }
+
+    void release_pages(const std::span<const PageStore::PageId> ids) {
+        m_page_store.release(ids);
+        m_base_ids.clear();  // The ids may be reused for other pages
+    }
+
+    /// Release the pages of a full state in the arena
+    void release_full_state(const State& state) {
+        read_full_state(m_arena.get(), state, m_page_ids);
+        release_pages(m_page_ids);
+    }
+
+    void load_state(const u8* records, const State& base, const State& state) {
+        if (state.m_index_in_bucket == 0) {
+            load_full_state(records, state, m_scratch);
+        } else {
+            load_base(records, base);
+            decode_delta(m_base, get_data(records, state), m_scratch);
+        }
+
+        auto buffer = detail::SpanInputBuffer{m_scratch};
+        auto archive = StateInputArchive{buffer};
+        detail::serialize_snapshot(m_emulator, archive);
+    }
+
+    /// Offset in the arena where size bytes can be stored after the newest state, if any, and within the budget
+    [[nodiscard]] std::optional<size_t> find_space(const size_t size) const {
+        if (get_used_bytes() + size > m_max_bytes) {
+            return std::nullopt;
+        }
+        if (m_states.empty()) {
+            return 0;
+        }
+
+        const auto head = m_states.front().m_offset;
+        const auto tail = m_states.back().m_offset + m_states.back().get_size();
+        if (m_states.back().m_offset >= head) {
+            // Not wrapped: free space after the newest state, and before the oldest state
+            if (size <= m_max_bytes - tail) return tail;
+            if (size <= head) return 0;
+        } else if (size <= head - tail) {
+            // Wrapped: free space between the newest and the oldest state
+            return tail;
+        }
+        return std::nullopt;
+    }
+
+    /// Remove the oldest bucket: its full state and all deltas based on it
+    void evict_oldest_bucket() {
+        if (m_cold.empty()) {
+            evict_oldest_hot_bucket();
+        } else {
+            remove_cold_bucket(0);
+        }
+    }
+
+    void evict_oldest_hot_bucket() {
+        release_full_state(m_states.front());
+        do {
+            m_hot_bytes -= m_states.front().get_size();
+            m_states.pop_front();
+        } while (!m_states.empty() && m_states.front().m_index_in_bucket != 0);
+        --m_num_hot_buckets;
+        --m_num_buckets;
+    }
+
+    void remove_cold_bucket(const size_t index) {
+        wait_for_jobs(m_cold[index]);
+        release_pages(m_cold[index].m_page_ids);
+        m_cold_bytes -= m_cold[index].get_size();
+        m_num_cold_states -= m_cold[index].m_states.size();
+        m_cold.erase(m_cold.begin() + static_cast<std::ptrdiff_t>(index));
+        --m_num_buckets;
+    }
+
+    /// Copy the kept states of the oldest hot bucket out of the arena, and start compressing them
+    void move_oldest_hot_bucket_to_cold() {
+        size_t count = 1;
+        while (count < m_states.size() && m_states[count].m_index_in_bucket != 0) {
+            ++count;
+        }
+
+        const auto id = m_next_bucket_id++;
+        const auto stride = get_stride(m_states[count - 1]);
+        if (!keeps_bucket(id, stride)) {
+            evict_oldest_hot_bucket();
+            return;
+        }
+
+        const auto is_kept = [&](const State& state) {
+            return state.m_index_in_bucket % std::min(stride, m_frames_in_bucket) == 0;
+        };
+        size_t raw_size = 0;
+        size_t bucket_size = 0;
+        for (size_t i = 0; i < count; ++i) {
+            bucket_size += m_states[i].get_size();
+            raw_size += is_kept(m_states[i]) ? m_states[i].get_size() : 0;
+        }
+
+        auto& bucket = m_cold.emplace_back();
+        bucket.m_id = id;
+        bucket.m_stride = stride;
+        bucket.m_raw_size = raw_size;
+        read_full_state(m_arena.get(), m_states.front(), bucket.m_page_ids);
+        bucket.m_raw.reserve(raw_size);
+        for (size_t i = 0; i < count; ++i) {
+            auto state = m_states.front();
+            m_states.pop_front();
+            if (!is_kept(state)) continue;
+
+            const auto* record = m_arena.get() + state.m_offset;
+            state.m_offset = bucket.m_raw.size();
+            bucket.m_raw.insert(bucket.m_raw.end(), record, record + state.get_size());
+            bucket.m_states.push_back(state);
+        }
+
+        m_hot_bytes -= bucket_size;
+        m_cold_bytes += bucket.get_size();
+        m_num_cold_states += bucket.m_states.size();
+        --m_num_hot_buckets;
+        submit(bucket, RewindCompressor::JobType::Compress);
+    }
+
+    /// Retention stride for a state of the given age
+    [[nodiscard]] size_t get_stride(const State& state) const {
+        const auto age = static_cast<double>(m_emulator.get_tick_count() - state.m_ticks) / Clock::ticks_per_second;
+        size_t stride = 1;
+        for (const auto& tier : m_retention) {
+            if (age < tier.m_min_age_seconds) break;
+            stride = tier.m_stride;
+        }
+        return stride;
+    }
+
+    /// Whether a bucket is kept at all for the given stride. Strides longer than a bucket keep every Nth bucket.
+    [[nodiscard]] bool keeps_bucket(const u64 id, const size_t stride) const {
+        return stride <= m_frames_in_bucket || id % (stride / m_frames_in_bucket) == 0;
+    }
+
+    /// Thin out the cold buckets which crossed into an older retention tier since the last push
+    ///
+    /// Buckets are ordered by age, so the ones crossing a tier are right before those which already crossed it.
+    void thin_history() {
+        const auto now = m_emulator.get_tick_count();
+        for (const auto& tier : m_retention) {
+            const auto min_age = static_cast<u64>(tier.m_min_age_seconds * Clock::ticks_per_second);
+            if (now < min_age) break;
+
+            auto index = static_cast<size_t>(std::ranges::partition_point(m_cold, [&](const ColdBucket& bucket) {
+                                                 return bucket.m_states.back().m_ticks <= now - min_age;
+                                             }) -
+                                             m_cold.begin());
+            while (index-- > 0 && m_cold[index].m_stride < tier.m_stride) {
+                // Removing a bucket does not move the older ones
+                if (!keeps_bucket(m_cold[index].m_id, tier.m_stride)) {
+                    remove_cold_bucket(index);
+                    continue;
+                }
+                m_cold[index].m_stride = tier.m_stride;
+                apply_thinning(m_cold[index]);
+            }
+        }
+    }
+
+    /// Drop the states of a cold bucket which are not a multiple of its stride, and compress the rest again
+    ///
+    /// Runs in steps as the worker finishes: decompress if needed, then compact on this thread, then compress.
+    void apply_thinning(ColdBucket& bucket) {
+        const auto stride = std::min(bucket.m_stride, m_frames_in_bucket);
+        const auto is_kept = [&](const State& state) { return state.m_index_in_bucket % stride == 0; };
+        if (std::ranges::all_of(bucket.m_states, is_kept)) return;
+        if (bucket.m_pending_jobs != 0) return;  // Continued by apply_result()
+
+        if (bucket.m_raw.empty()) {
+            submit(bucket, RewindCompressor::JobType::Decompress);
+            return;
+        }
+
+        m_cold_bytes -= bucket.get_size();
+        m_num_cold_states -= bucket.m_states.size();
+
+        size_t size = 0;
+        std::vector<State> kept;
+        for (auto state : bucket.m_states) {
+            if (!is_kept(state)) continue;
+
+            std::memmove(bucket.m_raw.data() + size, bucket.m_raw.data() + state.m_offset, state.get_size());
+            state.m_offset = size;
+            size += state.get_size();
+            kept.push_back(state);
+        }
+        bucket.m_states = std::move(kept);
+        bucket.m_raw.resize(size);
+        bucket.m_raw.shrink_to_fit();
+        bucket.m_raw_size = size;
+        bucket.m_compressed = {};
+
+        m_cold_bytes += bucket.get_size();
+        m_num_cold_states += bucket.m_states.size();
+        submit(bucket, RewindCompressor::JobType::Compress);
+    }
+
+    /// Whether the cold bucket at the given index should be kept decompressed, since pop_state() will reach it soon, or
+    /// it holds the state loaded by the last seek
+    [[nodiscard]] bool wants_raw(const size_t index) const {
+        if (m_loading_bucket == m_cold[index].m_id) return true;
+        if (m_cursor_ticks) {
+            const auto& states = m_cold[index].m_states;
+            if (states.front().m_ticks <= *m_cursor_ticks && *m_cursor_ticks <= states.back().m_ticks) return true;
+        }
+        if (m_states.size() >= m_frames_in_bucket) return false;
+        return index + 1 == m_cold.size() || (m_states.empty() && index + 2 == m_cold.size());
+    }
+
+    /// Start decompressing the cold buckets which pop_state() will reach soon
+    void prefetch() {
+        for (size_t i = m_cold.size() - std::min<size_t>(m_cold.size(), 2); i < m_cold.size(); ++i) {
+            auto& bucket = m_cold[i];
+            if (wants_raw(i) && bucket.m_raw.empty() && bucket.m_pending_jobs == 0) {
+                submit(bucket, RewindCompressor::JobType::Decompress);
+            }
+        }
+    }
+
+    /// Free the decompressed records of a cold bucket, if it is compressed and not in use by the worker
+    void release_raw(ColdBucket& bucket) {
+        if (bucket.m_raw.empty() || bucket.m_compressed.empty() || bucket.m_pending_jobs != 0) return;
+
+        m_cold_bytes -= bucket.m_raw.size();
+        bucket.m_raw = {};
+    }
+
+    void submit(ColdBucket& bucket, const RewindCompressor::JobType type) {
+        while (m_num_pending_jobs >= RewindCompressor::max_pending_jobs) {
+            apply_result(m_compressor.wait());
+        }
+
+        ++bucket.m_pending_jobs;
+        ++m_num_pending_jobs;
+        const bool compress = type == RewindCompressor::JobType::Compress;
+        m_compressor.submit({
+            .m_id = bucket.m_id,
+            .m_type = type,
+            .m_input = compress ? std::span<const u8>{bucket.m_raw} : std::span<const u8>{bucket.m_compressed},
+            .m_output_size = bucket.m_raw_size,
+        });
+    }
+
+    void receive_results() {
+        while (auto result = m_compressor.poll()) {
+            apply_result(std::move(*result));
+        }
+    }
+
+    void wait_for_jobs(const ColdBucket& bucket) {
+        while (bucket.m_pending_jobs != 0) {
+            apply_result(m_compressor.wait());
+        }
+    }
+
+    void apply_result(RewindCompressor::Result result) {
+        // Buckets are ordered by id, and are not removed while they have pending jobs
+        const auto it = std::ranges::lower_bound(m_cold, result.m_id, {}, &ColdBucket::m_id);
+        const auto index = static_cast<size_t>(it - m_cold.begin());
+        auto& bucket = *it;
+
+        --bucket.m_pending_jobs;
+        --m_num_pending_jobs;
+        if (result.m_type == RewindCompressor::JobType::Compress) {
+            m_cold_bytes += result.m_output.size();
+            bucket.m_compressed = std::move(result.m_output);
+        } else if (bucket.m_raw.empty()) {
+            m_cold_bytes += result.m_output.size();
+            bucket.m_raw = std::move(result.m_output);
+        }
+
+        apply_thinning(bucket);
+        if (!wants_raw(index)) {
+            release_raw(bucket);
         }
-        return m_buckets.back();
     }
 
     TEmulator& m_emulator;
     size_t m_max_bytes;
     size_t m_max_buckets;
     size_t m_frames_in_bucket;
-    std::vector<Bucket> m_buckets;
+    size_t m_hot_buckets;
+    std::vector<RetentionTier> m_retention = default_retention();
+    size_t m_capture_interval = 1;
+    size_t m_frames_until_capture = 0;
+
+    std::unique_ptr<u8[]> m_arena;
+    std::deque<State> m_states;  ///< Hot states in the arena, oldest first
+    size_t m_hot_bytes = 0;      ///< Sum of the sizes of m_states
+    size_t m_num_hot_buckets = 0;
+
+    std::deque<ColdBucket> m_cold;  ///< Older than all hot states, oldest first
+    size_t m_cold_bytes = 0;        ///< Sum of the sizes of m_cold
+    size_t m_num_cold_states = 0;
+    size_t m_num_pending_jobs = 0;
+    u64 m_next_bucket_id = 0;
+
+    size_t m_num_buckets = 0;  ///< Hot and cold
+
+    PageStore m_page_store;  ///< Pages of the full states, hot and cold
+
+    std::optional<u64> m_cursor_ticks;    ///< State loaded by the last seek, see seek_to_ticks()
+    std::optional<u64> m_loading_bucket;  ///< Cold bucket being decompressed for immediate use, see get_raw()
+    bool m_store_screenshots = true;
+
+    // Reused between calls, to avoid allocating for every frame
+    std::vector<u8> m_scratch;
+    std::vector<u8> m_delta;
+    std::vector<u8> m_full_state;
+    std::vector<PageStore::PageId> m_full_state_ids;
+    std::vector<PageStore::PageId> m_page_ids;
+    std::vector<u8> m_base;                     ///< Full state last loaded by load_base()
+    std::vector<PageStore::PageId> m_base_ids;  ///< Pages of m_base, or empty if unknown
+    std::vector<ByteRange> m_dirty_ranges;
+    std::vector<u8> m_packed_screen;
+    std::vector<u8> m_screenshot_delta;
+
+    /// Last, so the worker is stopped before the buckets its jobs read from are destroyed
+    RewindCompressor m_compressor;
 };
 }  // namespace bemu::gb
@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "../types.hpp"
+#include "lz.hpp"
+#include "spsc_queue.hpp"
+
+namespace bemu::gb {
+/// Compresses and decompresses rewind buckets on a worker thread
+///
+/// Jobs and results are passed through lock-free queues, and the worker sleeps on an atomic counter while there is
+/// nothing to do, so submitting a job never blocks the caller. Only one thread may submit jobs and receive results.
+///
+/// The input of a job is borrowed: it must stay alive and unmodified until its result has been received.
+struct RewindCompressor {
+    enum class JobType : u8 { Compress, Decompress };
+
+    struct Job {
+        u64 m_id = 0;
+        JobType m_type = JobType::Compress;
+        std::span<const u8> m_input;
+        size_t m_output_size = 0;  ///< Size of the decompressed data, for Decompress jobs
+    };
+
+    struct Result {
+        u64 m_id = 0;
+        JobType m_type = JobType::Compress;
+        std::vector<u8> m_output;
+    };
+
+    /// Maximum number of jobs whose results have not been received yet
+    static constexpr size_t max_pending_jobs = 64;
+
+    RewindCompressor() : m_thread([this] { worker_loop(); }) {}
+
+    RewindCompressor(const RewindCompressor&) = delete;
+    RewindCompressor& operator=(const RewindCompressor&) = delete;
+
+    /// Finishes the submitted jobs before returning
+    ~RewindCompressor() {
+        m_stop.store(true, std::memory_order_release);
+        signal(m_jobs_signal);
+        m_thread.join();
+    }
+
+    void submit(Job job) {
+        while (!m_jobs.try_push(std::move(job))) {
+            std::this_thread::yield();  // Only if more than max_pending_jobs results were not received
+        }
+        signal(m_jobs_signal);
+    }
+
+    /// Result of a finished job, if any
+    std::optional<Result> poll() { return m_results.try_pop(); }
+
+    /// Wait for the next finished job. There must be a job in progress.
+    Result wait() {
+        while (true) {
+            const auto seen = m_results_signal.load(std::memory_order_acquire);
+            if (auto result = poll()) {
+                return std::move(*result);
+            }
+            m_results_signal.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+   private:
+    static void signal(std::atomic<u32>& counter) {
+        counter.fetch_add(1, std::memory_order_release);
+        counter.notify_one();
+    }
+
+    void worker_loop() {
+        while (true) {
+            const auto seen = m_jobs_signal.load(std::memory_order_acquire);
+            while (auto job = m_jobs.try_pop()) {
+                Result result{.m_id = job->m_id, .m_type = job->m_type};
+                if (job->m_type == JobType::Compress) {
+                    result.m_output.reserve(job->m_input.size() / 2);
+                    lz_compress(job->m_input, result.m_output);
+                    result.m_output.shrink_to_fit();
+                } else {
+                    result.m_output.resize(job->m_output_size);
+                    lz_decompress(job->m_input, result.m_output);
+                }
+
+                while (!m_results.try_push(std::move(result))) {
+                    std::this_thread::yield();
+                }
+                signal(m_results_signal);
+            }
+
+            if (m_stop.load(std::memory_order_acquire)) return;
+            m_jobs_signal.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    SpscQueue<Job, max_pending_jobs> m_jobs;
+    SpscQueue<Result, max_pending_jobs> m_results;
+    std::atomic<u32> m_jobs_signal = 0;
+    std::atomic<u32> m_results_signal = 0;
+    std::atomic<bool> m_stop = false;
+    std::thread m_thread;  ///< Last, so the queues exist before the worker starts
+};
+}  // namespace bemu::gb
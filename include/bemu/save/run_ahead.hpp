@@ -0,0 +1,56 @@
+#pragma once
+#include "../screen.hpp"
+#include "snapshot.hpp"
+
+namespace bemu::gb {
+/// Hides the game's internal input lag by running ahead
+///
+/// Most games only react to input one or more frames after it was read. After the input for frame N has been applied
+/// and frame N emulated, we save a snapshot, emulate the next m_frames frames without rendering (except for the last
+/// one), keep the last frame for display, and restore the snapshot. The displayed frame is therefore the one the game
+/// would show m_frames frames from now, given the current input.
+///
+/// With m_frames == 0, this is the same as calling run_to_next_frame() directly.
+template <class TEmulator>
+struct RunAhead {
+    explicit RunAhead(TEmulator& emulator, const size_t frames = 0) : m_emulator(emulator), m_frames(frames) {}
+
+    [[nodiscard]] size_t get_frames() const { return m_frames; }
+    void set_frames(const size_t frames) { m_frames = frames; }
+
+    /// Run one real frame, followed by the speculative run-ahead frames
+    ///
+    /// Returns false if the emulator stopped running during the real frame.
+    bool run_frame() {
+        if (!m_emulator.run_to_next_frame()) return false;
+        if (m_frames == 0) return true;
+
+        save_snapshot(m_emulator, m_snapshot);
+
+        for (size_t i = 0; i < m_frames; ++i) {
+            // Only the last frame is ever displayed
+            m_emulator.m_external->m_skip_rendering = i + 1 < m_frames;
+            if (!m_emulator.run_to_next_frame()) break;
+        }
+        m_emulator.m_external->m_skip_rendering = false;
+
+        m_screen = m_emulator.get_screen();
+
+        // The snapshot only differs in the pages written since it was taken, which are still marked dirty
+        m_dirty_pages.save(m_emulator);
+        load_snapshot(m_emulator, m_snapshot);
+        m_dirty_pages.restore(m_emulator);
+        return true;
+    }
+
+    /// Screen to display: the last run-ahead frame, or the emulator screen if run-ahead is disabled
+    [[nodiscard]] const Screen& get_screen() const { return m_frames == 0 ? m_emulator.get_screen() : m_screen; }
+
+   private:
+    TEmulator& m_emulator;
+    size_t m_frames;
+    Snapshot m_snapshot;
+    DirtyPagesCopy m_dirty_pages;
+    Screen m_screen;
+};
+}  // namespace bemu::gb
@@ -1,37 +1,55 @@
 #pragma once
+#include <cstring>
 #include <span>
+#include <stdexcept>
 #include <type_traits>
 #include <vector>
 
 #include "../gb/emulator.hpp"
 
 namespace bemu::gb {
+/// Output buffer which can also write a contiguous block of bytes in one call
+template <typename Buffer>
+concept BulkOutputBuffer = requires(Buffer& buffer, std::span<const u8> data) { buffer.write_bytes(data); };
+
+/// Input buffer which can also read a contiguous block of bytes in one call
+template <typename Buffer>
+concept BulkInputBuffer = requires(Buffer& buffer, std::span<u8> data) { buffer.read_bytes(data); };
+
 template <typename Buffer>
 struct StateOutputArchive {
+    static constexpr bool is_loading = false;
+
     explicit StateOutputArchive(Buffer& buffer) : m_buffer(buffer) {}
 
     template <typename T>
         requires std::is_trivially_copyable_v<T>
     void operator()(const T& value) {
         const auto data = reinterpret_cast<const u8*>(&value);
-        for (size_t i = 0; i < sizeof(T); ++i) {
-            m_buffer.write(data[i]);
+        if constexpr (BulkOutputBuffer<Buffer>) {
+            m_buffer.write_bytes({data, sizeof(T)});
+        } else {
+            for (size_t i = 0; i < sizeof(T); ++i) {
+                m_buffer.write(data[i]);
+            }
         }
     }
 
     template <typename T>
     void operator()(std::span<T> value) {
-        for (const auto& v : value) {
-            this->operator()(v);
+        if constexpr (BulkOutputBuffer<Buffer> && std::is_trivially_copyable_v<T>) {
+            m_buffer.write_bytes({reinterpret_cast<const u8*>(value.data()), value.size_bytes()});
+        } else {
+            for (const auto& v : value) {
+                this->operator()(v);
+            }
         }
     }
 
     template <typename T>
     void operator()(const std::vector<T>& value) {
         this->operator()(value.size());
-        for (const auto& v : value) {
-            this->operator()(v);
-        }
+        this->operator()(std::span<const T>{value});
     }
 
    private:
@@ -40,21 +58,31 @@ struct StateOutputArchive {
 
 template <typename Buffer>
 struct StateInputArchive {
+    static constexpr bool is_loading = true;
+
     explicit StateInputArchive(Buffer& buffer) : m_buffer(buffer) {}
 
     template <typename T>
         requires std::is_trivially_copyable_v<T>
     void operator()(T& value) {
         auto data = reinterpret_cast<u8*>(&value);
-        for (size_t i = 0; i < sizeof(T); ++i) {
-            data[i] = m_buffer.read();
+        if constexpr (BulkInputBuffer<Buffer>) {
+            m_buffer.read_bytes({data, sizeof(T)});
+        } else {
+            for (size_t i = 0; i < sizeof(T); ++i) {
+                data[i] = m_buffer.read();
+            }
         }
     }
 
     template <typename T>
     void operator()(std::span<T> value) {
-        for (auto& v : value) {
-            this->operator()(v);
+        if constexpr (BulkInputBuffer<Buffer> && std::is_trivially_copyable_v<T>) {
+            m_buffer.read_bytes({reinterpret_cast<u8*>(value.data()), value.size_bytes()});
+        } else {
+            for (auto& v : value) {
+                this->operator()(v);
+            }
         }
     }
 
@@ -63,13 +91,49 @@ struct StateInputArchive {
         size_t s = 0;
         this->operator()(s);
         value.resize(s);
-
-        for (auto& v : value) {
-            this->operator()(v);
-        }
+        this->operator()(std::span<T>{value});
     }
 
    private:
     Buffer& m_buffer;
 };
+
+namespace detail {
+/// Reads from a contiguous block of memory
+struct SpanInputBuffer {
+    std::span<const u8> m_data;
+    size_t m_index = 0;
+
+    u8 read() {
+        u8 data = 0;
+        read_bytes({&data, 1});
+        return data;
+    }
+
+    void read_bytes(const std::span<u8> data) {
+        if (m_index + data.size() > m_data.size()) {
+            throw std::runtime_error("Save state too small");
+        }
+        std::memcpy(data.data(), m_data.data() + m_index, data.size());
+        m_index += data.size();
+    }
+};
+
+/// Output buffer which only counts the bytes written
+struct SizeCountingBuffer {
+    size_t m_size = 0;
+
+    void write(u8) { ++m_size; }
+    void write_bytes(const std::span<const u8> data) { m_size += data.size(); }
+};
+}  // namespace detail
+
+/// Exact number of bytes serialize() writes for the emulator's current state, e.g. to allocate the output once
+template <typename TEmulator>
+[[nodiscard]] size_t get_serialized_size(TEmulator& emulator) {
+    auto buffer = detail::SizeCountingBuffer{};
+    auto archive = StateOutputArchive{buffer};
+    emulator.serialize(archive);
+    return buffer.m_size;
+}
 }  // namespace bemu::gb
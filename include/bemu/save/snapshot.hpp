@@ -0,0 +1,144 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "../gb/dirty_pages.hpp"
+#include "../types.hpp"
+#include "delta.hpp"
+#include "save_state.hpp"
+
+namespace bemu::gb {
+/// In-memory save state, for saving and restoring several times per frame, e.g. for run-ahead
+///
+/// The storage is kept between saves, so only the first save allocates (unless the state grows).
+struct Snapshot {
+    [[nodiscard]] bool empty() const { return m_size == 0; }
+    [[nodiscard]] std::span<const u8> data() const { return {m_data.data(), m_size}; }
+
+    std::vector<u8> m_data;
+    size_t m_size = 0;  ///< Number of bytes in m_data used by the last save
+};
+
+namespace detail {
+struct SnapshotOutputBuffer {
+    std::vector<u8>& m_data;
+    size_t m_index = 0;
+
+    void write(const u8 data) { write_bytes({&data, 1}); }
+
+    void write_bytes(const std::span<const u8> data) {
+        if (m_index + data.size() > m_data.size()) {
+            m_data.resize(std::max(m_index + data.size(), 2 * m_data.size()));
+        }
+        std::memcpy(m_data.data() + m_index, data.data(), data.size());
+        m_index += data.size();
+    }
+};
+
+/// Use the emulator's raw snapshot layout if it has one, see Emulator::serialize_snapshot()
+template <typename TEmulator, typename TArchive>
+void serialize_snapshot(TEmulator& emulator, TArchive& archive) {
+    if constexpr (requires { emulator.serialize_snapshot(archive); }) {
+        emulator.serialize_snapshot(archive);
+    } else {
+        emulator.serialize(archive);
+    }
+}
+
+/// Ranges of the serialize_snapshot() output which may have changed since clear_dirty_pages(), or everything if the
+/// emulator does not track them
+template <typename TEmulator>
+void get_dirty_snapshot_ranges(const TEmulator& emulator, std::vector<ByteRange>& ranges) {
+    ranges.clear();
+    if constexpr (requires { emulator.for_each_dirty_snapshot_range([](size_t, size_t) {}); }) {
+        emulator.for_each_dirty_snapshot_range(
+            [&](const size_t offset, const size_t size) { ranges.push_back({offset, size}); });
+    } else {
+        ranges.push_back({0, SIZE_MAX});
+    }
+}
+
+/// Start tracking the changes since now, see get_dirty_snapshot_ranges()
+template <typename TEmulator>
+void clear_dirty_pages(TEmulator& emulator) {
+    if constexpr (requires { emulator.m_dirty_pages.clear(); }) {
+        emulator.m_dirty_pages.clear();
+    }
+}
+}  // namespace detail
+
+/// Copy of the dirty pages of an emulator, those of its state (see get_dirty_snapshot_ranges()) and of its cartridge
+/// RAM (see BatterySave), if it tracks them
+///
+/// Loading a snapshot marks every page dirty, since the loaded state may differ anywhere. When it can only differ in
+/// pages which are marked already, e.g. when restoring a snapshot taken before running ahead, save() the pages before
+/// loading and restore() them after, so the next rewind delta or battery save flush only compares those pages.
+struct DirtyPagesCopy {
+    template <typename TEmulator>
+    void save(TEmulator& emulator) {
+        if constexpr (tracks_dirty_pages<TEmulator>) {
+            m_state = emulator.m_dirty_pages;
+            m_ram = emulator.m_cartridge->get_ram_dirty_pages();
+        }
+    }
+
+    template <typename TEmulator>
+    void restore(TEmulator& emulator) const {
+        if constexpr (tracks_dirty_pages<TEmulator>) {
+            emulator.m_dirty_pages = m_state;
+            emulator.m_cartridge->get_ram_dirty_pages() = m_ram;
+        }
+    }
+
+    /// Also mark the saved pages dirty in emulator
+    template <typename TEmulator>
+    void mark(TEmulator& emulator) const {
+        if constexpr (tracks_dirty_pages<TEmulator>) {
+            emulator.m_dirty_pages.mark(m_state);
+            emulator.m_cartridge->get_ram_dirty_pages().mark(m_ram);
+        }
+    }
+
+    /// Start tracking the pages emulator writes from now on, e.g. to save() them after a frame
+    template <typename TEmulator>
+    static void clear(TEmulator& emulator) {
+        if constexpr (tracks_dirty_pages<TEmulator>) {
+            emulator.m_dirty_pages.clear();
+            emulator.m_cartridge->get_ram_dirty_pages().clear();
+        }
+    }
+
+   private:
+    template <typename TEmulator>
+    static constexpr bool tracks_dirty_pages = requires(TEmulator& emulator) {
+        emulator.m_dirty_pages.clear();
+        emulator.m_cartridge->get_ram_dirty_pages().clear();
+    };
+
+    DirtyPages m_state;
+    DirtyPages m_ram;
+};
+
+template <typename TEmulator>
+void save_snapshot(TEmulator& emulator, Snapshot& snapshot) {
+    auto buffer = detail::SnapshotOutputBuffer{snapshot.m_data};
+    auto archive = StateOutputArchive{buffer};
+    detail::serialize_snapshot(emulator, archive);
+    snapshot.m_size = buffer.m_index;
+}
+
+template <typename TEmulator>
+void load_snapshot(TEmulator& emulator, const Snapshot& snapshot) {
+    if (snapshot.empty()) {
+        throw std::invalid_argument("Cannot load empty snapshot");
+    }
+
+    auto buffer = detail::SpanInputBuffer{snapshot.data()};
+    auto archive = StateInputArchive{buffer};
+    detail::serialize_snapshot(emulator, archive);
+}
+}  // namespace bemu::gb
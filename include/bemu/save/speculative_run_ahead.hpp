@@ -0,0 +1,213 @@
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../screen.hpp"
+#include "../utils.hpp"
+#include "run_ahead.hpp"
+#include "snapshot.hpp"
+
+namespace bemu::gb {
+struct SpeculationStats {
+    u64 m_hits = 0;    ///< Frames taken from a finished speculation
+    u64 m_misses = 0;  ///< Frames emulated on the calling thread, since no speculation matched the input
+};
+
+/// Run-ahead which predicts the next frame on worker threads
+///
+/// After each frame, every worker takes one likely input for the next frame (the same buttons, or one button toggled)
+/// and emulates the next frame plus the run-ahead frames on its own clone of the emulator, while the caller waits for
+/// the next frame to start. When the real input arrives, the state of the matching worker is loaded into the emulator
+/// and its last frame is displayed, instead of emulating the frame and the run-ahead frames serially.
+///
+/// If no speculation matches the input, or there are no worker threads, this falls back to RunAhead.
+template <class TEmulator>
+struct SpeculativeRunAhead {
+    SpeculativeRunAhead(TEmulator& emulator, const size_t frames, const size_t num_threads)
+        : m_emulator(emulator), m_run_ahead(emulator, frames) {
+        for (size_t i = 0; i < num_threads; ++i) {
+            m_workers.push_back(std::make_unique<Worker>(m_emulator.clone(), frames));
+        }
+        for (auto& worker : m_workers) {
+            worker->m_thread = std::thread([this, &worker = *worker] { worker_loop(worker); });
+        }
+    }
+
+    SpeculativeRunAhead(const SpeculativeRunAhead&) = delete;
+    SpeculativeRunAhead& operator=(const SpeculativeRunAhead&) = delete;
+
+    ~SpeculativeRunAhead() {
+        {
+            std::lock_guard lock{m_mutex};
+            m_stop = true;
+        }
+        m_work_available.notify_all();
+
+        for (auto& worker : m_workers) {
+            worker->m_thread.join();
+        }
+    }
+
+    /// Run one frame with the given buttons pushed, followed by the run-ahead frames
+    ///
+    /// \param buttons Bit mask where bit N is set if Joypad::Button N is pushed
+    /// \return false if the emulator stopped running
+    bool run_frame(const u8 buttons) {
+        if (const auto* worker = wait_for_speculation(buttons)) {
+            // The worker's state only differs from ours in the pages its frame wrote
+            m_dirty_pages.save(m_emulator);
+            load_snapshot(m_emulator, worker->m_state);
+            m_dirty_pages.restore(m_emulator);
+            worker->m_written.mark(m_emulator);
+            m_screen = worker->m_run_ahead.get_screen();
+            ++m_stats.m_hits;
+        } else {
+            m_emulator.m_external->set_buttons(buttons);
+            if (!m_run_ahead.run_frame()) return false;
+            m_screen = m_run_ahead.get_screen();
+            ++m_stats.m_misses;
+        }
+
+        start_speculation(buttons);
+        return true;
+    }
+
+    /// Discard speculations for the next frame. Must be called when the emulator state is changed externally, e.g. by
+    /// rewinding or loading a save state.
+    void invalidate() {
+        wait_idle();
+        m_base_valid = false;
+    }
+
+    /// Screen to display: the last run-ahead frame
+    [[nodiscard]] const Screen& get_screen() const { return m_screen; }
+
+    [[nodiscard]] const SpeculationStats& get_stats() const { return m_stats; }
+
+   private:
+    struct Worker {
+        Worker(std::unique_ptr<TEmulator> emulator, const size_t frames)
+            : m_emulator(std::move(emulator)), m_run_ahead(*m_emulator, frames) {}
+
+        std::unique_ptr<TEmulator> m_emulator;
+        RunAhead<TEmulator> m_run_ahead;
+        std::thread m_thread;
+
+        // Guarded by m_mutex
+        u8 m_input = 0;
+        bool m_has_job = false;
+        bool m_done = false;
+
+        /// State after the speculated frame, and the pages written since m_base. Only accessed by the worker while it
+        /// has a job.
+        Snapshot m_state;
+        DirtyPagesCopy m_written;
+    };
+
+    /// Likely inputs for the next frame, most likely first: unchanged, then a single button released, then a single
+    /// button pushed.
+    static std::vector<u8> predict_inputs(const u8 buttons, const size_t count) {
+        std::vector<u8> result{buttons};
+        for (const bool pushed : {true, false}) {
+            for (u8 button = 0; button < 8 && result.size() < count; ++button) {
+                if (get_bit(buttons, button) == pushed) {
+                    result.push_back(buttons ^ (1 << button));
+                }
+            }
+        }
+        result.resize(std::min(result.size(), count));
+        return result;
+    }
+
+    void start_speculation(const u8 buttons) {
+        if (m_workers.empty()) return;
+
+        save_snapshot(m_emulator, m_base);
+        m_base_ticks = m_emulator.get_tick_count();
+        m_base_valid = true;
+
+        const auto inputs = predict_inputs(buttons, m_workers.size());
+        {
+            std::lock_guard lock{m_mutex};
+            for (size_t i = 0; i < m_workers.size(); ++i) {
+                auto& worker = *m_workers[i];
+                worker.m_has_job = i < inputs.size();
+                worker.m_done = false;
+                if (worker.m_has_job) {
+                    worker.m_input = inputs[i];
+                }
+            }
+            m_pending = inputs.size();
+        }
+        m_work_available.notify_all();
+    }
+
+    /// Wait for the current speculations to finish, and return the worker which speculated the given input, if any
+    const Worker* wait_for_speculation(const u8 buttons) {
+        wait_idle();
+        if (!m_base_valid || m_base_ticks != m_emulator.get_tick_count()) return nullptr;
+
+        for (const auto& worker : m_workers) {
+            if (worker->m_done && worker->m_input == buttons) {
+                return worker.get();
+            }
+        }
+        return nullptr;
+    }
+
+    void wait_idle() {
+        std::unique_lock lock{m_mutex};
+        m_work_done.wait(lock, [this] { return m_pending == 0; });
+    }
+
+    void worker_loop(Worker& worker) {
+        while (true) {
+            u8 input = 0;
+            {
+                std::unique_lock lock{m_mutex};
+                m_work_available.wait(lock, [&] { return m_stop || worker.m_has_job; });
+                if (m_stop) return;
+
+                worker.m_has_job = false;
+                input = worker.m_input;
+            }
+
+            // m_base is not modified while any job is pending
+            load_snapshot(*worker.m_emulator, m_base);
+            DirtyPagesCopy::clear(*worker.m_emulator);
+            worker.m_emulator->m_external->set_buttons(input);
+            worker.m_run_ahead.run_frame();
+            save_snapshot(*worker.m_emulator, worker.m_state);
+            worker.m_written.save(*worker.m_emulator);
+
+            {
+                std::lock_guard lock{m_mutex};
+                worker.m_done = true;
+                --m_pending;
+            }
+            m_work_done.notify_all();
+        }
+    }
+
+    TEmulator& m_emulator;
+    RunAhead<TEmulator> m_run_ahead;
+    Screen m_screen;
+    SpeculationStats m_stats;
+    DirtyPagesCopy m_dirty_pages;
+
+    /// State the current speculations started from
+    Snapshot m_base;
+    u64 m_base_ticks = 0;
+    bool m_base_valid = false;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_work_done;
+    size_t m_pending = 0;  ///< Number of workers with unfinished jobs. Guarded by m_mutex.
+    bool m_stop = false;   ///< Guarded by m_mutex
+};
+}  // namespace bemu::gb
@@ -0,0 +1,43 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <optional>
+
+namespace bemu::gb {
+/// Bounded lock-free queue for exactly one producer thread and one consumer thread
+template <typename T, size_t Capacity>
+    requires(std::has_single_bit(Capacity))
+struct SpscQueue {
+    /// Called by the producer. Returns false, leaving value untouched, if the queue is full.
+    bool try_push(T&& value) {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+
+        m_slots[tail % Capacity] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Called by the consumer
+    std::optional<T> try_pop() {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+
+        std::optional<T> result{std::move(m_slots[head % Capacity])};
+        m_head.store(head + 1, std::memory_order_release);
+        return result;
+    }
+
+   private:
+    std::array<T, Capacity> m_slots{};
+
+    // On separate cache lines, since each is written by a different thread
+    alignas(64) std::atomic<size_t> m_head = 0;
+    alignas(64) std::atomic<size_t> m_tail = 0;
+};
+}  // namespace bemu::gb
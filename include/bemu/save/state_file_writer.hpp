@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../types.hpp"
+#include "file.hpp"
+#include "spsc_queue.hpp"
+
+namespace bemu::gb {
+/// Writes save state files on a worker thread, so saving never stalls a frame on compression or a slow disk
+///
+/// save() only captures the state (see capture_state()) on the calling thread, and queues it. The worker encodes the
+/// file and writes it with write_file_atomically(), so an interrupted save never leaves a broken file behind. The
+/// outcome of each save is reported through poll(), e.g. to show it in the UI. Only one thread may call save() and
+/// poll().
+struct StateFileWriter {
+    struct Result {
+        std::string m_filename;
+        std::string m_error;  ///< Empty if the file was written
+
+        [[nodiscard]] bool succeeded() const { return m_error.empty(); }
+    };
+
+    /// Maximum number of saves whose results have not been received yet
+    static constexpr size_t max_pending_saves = 8;
+
+    explicit StateFileWriter(const bool compress = true) : m_compress(compress), m_thread([this] { worker_loop(); }) {}
+
+    StateFileWriter(const StateFileWriter&) = delete;
+    StateFileWriter& operator=(const StateFileWriter&) = delete;
+
+    /// Finishes the queued saves before returning
+    ~StateFileWriter() {
+        m_stop.store(true, std::memory_order_release);
+        signal(m_jobs_signal);
+        m_thread.join();
+    }
+
+    /// Capture the state of the emulator, and queue writing it to filename
+    ///
+    /// \return false, without saving, if max_pending_saves results have not been received with poll()
+    template <typename TEmulator>
+    bool save(TEmulator& emulator, std::string filename) {
+        if (m_num_pending == max_pending_saves) {
+            return false;
+        }
+
+        Job job{.m_filename = std::move(filename)};
+        capture_state(emulator, job.m_state);
+        m_jobs.try_push(std::move(job));  // Cannot fail: there are fewer than max_pending_saves jobs
+        ++m_num_pending;
+        signal(m_jobs_signal);
+        return true;
+    }
+
+    /// Number of saves whose results have not been received yet
+    [[nodiscard]] size_t get_num_pending() const { return m_num_pending; }
+
+    /// Result of a finished save, if any
+    std::optional<Result> poll() {
+        auto result = m_results.try_pop();
+        if (result) {
+            --m_num_pending;
+        }
+        return result;
+    }
+
+    /// Wait for the next finished save. There must be a save pending.
+    Result wait() {
+        if (m_num_pending == 0) {
+            throw std::logic_error("No save pending");
+        }
+
+        while (true) {
+            const auto seen = m_results_signal.load(std::memory_order_acquire);
+            if (auto result = poll()) {
+                return std::move(*result);
+            }
+            m_results_signal.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+   private:
+    struct Job {
+        std::string m_filename;
+        CapturedState m_state;
+    };
+
+    static void signal(std::atomic<u32>& counter) {
+        counter.fetch_add(1, std::memory_order_release);
+        counter.notify_one();
+    }
+
+    void worker_loop() {
+        std::vector<u8> file;
+        while (true) {
+            const auto seen = m_jobs_signal.load(std::memory_order_acquire);
+            while (auto job = m_jobs.try_pop()) {
+                Result result{.m_filename = std::move(job->m_filename)};
+                try {
+                    encode_state_file(job->m_state, m_compress, file);
+                    write_file_atomically(result.m_filename, file);
+                } catch (const std::exception& ex) {
+                    result.m_error = ex.what();
+                }
+
+                // Cannot fail: each result belongs to one of at most max_pending_saves jobs
+                m_results.try_push(std::move(result));
+                signal(m_results_signal);
+            }
+
+            if (m_stop.load(std::memory_order_acquire)) return;
+            m_jobs_signal.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    bool m_compress;
+    size_t m_num_pending = 0;  ///< Saves queued, in progress, or with unreceived results
+
+    SpscQueue<Job, max_pending_saves> m_jobs;
+    SpscQueue<Result, max_pending_saves> m_results;
+    std::atomic<u32> m_jobs_signal = 0;
+    std::atomic<u32> m_results_signal = 0;
+    std::atomic<bool> m_stop = false;
+    std::thread m_thread;  ///< Last, so the queues exist before the worker starts
+};
+}  // namespace bemu::gb
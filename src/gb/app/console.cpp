@@ -1,15 +1,22 @@
 #include <ncurses.h>
 
 #include <../../../include/bemu/save/file.hpp>
+#include <bemu/gb/battery_save.hpp>
 #include <bemu/gb/cartridge.hpp>
 #include <bemu/gb/clock.hpp>
 #include <bemu/gb/emulator.hpp>
+#include <bemu/gb/options.hpp>
 #include <bemu/io/curses.hpp>
 #include <bemu/io/keyboard.hpp>
 #include <bemu/io/x11.hpp>
+#include <bemu/save/hibernate.hpp>
 #include <bemu/save/rewind.hpp>
+#include <bemu/save/speculative_run_ahead.hpp>
+#include <bemu/save/state_file_writer.hpp>
 #include <clocale>
+#include <csignal>
 #include <iostream>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
@@ -18,6 +25,9 @@ using namespace bemu;
 using namespace bemu::gb;
 
 namespace {
+/// Set by SIGINT and SIGTERM, to exit cleanly (and hibernate)
+volatile std::sig_atomic_t g_quit = 0;
+
 std::unordered_map<Key, Joypad::Button> key_to_button = {
     {Key::Up, Joypad::BUTTON_UP},       {Key::W, Joypad::BUTTON_UP},        {Key::Down, Joypad::BUTTON_DOWN},
     {Key::S, Joypad::BUTTON_DOWN},      {Key::Left, Joypad::BUTTON_LEFT},   {Key::A, Joypad::BUTTON_LEFT},
@@ -34,7 +44,12 @@ std::unordered_map<Key, Joypad::Button> key_to_button = {
 }
 
 struct App : IKeyReceiver {
-    explicit App(Emulator &emulator) : m_emulator(emulator), m_keys(*this) {
+    /// battery may be null, if the cartridge has no battery save
+    App(Emulator &emulator, const Options &options, BatterySave *battery)
+        : m_emulator(emulator),
+          m_battery(battery),
+          m_run_ahead(emulator, options.m_run_ahead_frames, options.m_speculative_threads),
+          m_keys(*this) {
         setlocale(LC_ALL, "");
         initscr();              // start curses mode
         noecho();               // don't echo keypresses
@@ -82,7 +97,7 @@ struct App : IKeyReceiver {
 
     void on_key_pressed(const Key key) {
         if (const auto it = key_to_button.find(key); it != key_to_button.end()) {
-            m_emulator.m_external->m_pending_buttons[it->second] = true;
+            set_bit(m_buttons, it->second);
         } else if (key == Key::Number_1) {
             m_clock.m_speedup_factor = 1.0;
         } else if (key == Key::Number_2) {
@@ -104,21 +119,24 @@ struct App : IKeyReceiver {
         } else if (key == Key::Number_0) {
             m_clock.m_speedup_factor = 1e10;
         } else if (key == Key::Plus) {
-            save_state_to_file(m_emulator, "test.sav");
-
+            m_save_status = m_state_writer.save(m_emulator, "test.sav") ? "saving" : "busy";
         } else if (key == Key::Backslash) {
-            load_state_from_file(m_emulator, "test.sav");
+            try {
+                load_state_from_file(m_emulator, "test.sav");
+                m_run_ahead.invalidate();
+            } catch (const std::runtime_error&) {
+                // No save state yet, or a truncated one; keep running
+            }
         }
     }
 
     void on_key_released(const Key key) {
         if (const auto it = key_to_button.find(key); it != key_to_button.end()) {
-            m_emulator.m_external->m_pending_buttons[it->second] = false;
+            set_bit(m_buttons, it->second, false);
         }
     }
 
-    void draw() {
-        const auto &screen = m_emulator.m_external->m_screen;
+    void draw(const Screen &screen) {
         std::optional<int> current_color_pair;
 
         for (int y = 0; y < screen.get_height() - 1; y += 2) {
@@ -147,10 +165,13 @@ struct App : IKeyReceiver {
         // Draw status bar
         attron(COLOR_PAIR(25));
         const std::string status = std::format(
-            "Keys: {}{}    Rewind: {:>3} MiB, {:>5} states, {:>5} seconds", m_keys.is_key_pressed(Key::W) ? 'W' : ' ',
-            m_keys.is_key_pressed(Key::S) ? 'S' : ' ', m_rewind.get_used_bytes() / 1024 / 1024,
-            m_rewind.get_num_states(), (m_emulator.m_external->m_ticks - m_rewind.get_first_ticks()) / 4194304);
+            "Keys: {}{}    Rewind: {:>3} MiB, {:>5} states, {:>5} seconds    Late: {:>5}    Save: {}",
+            m_keys.is_key_pressed(Key::W) ? 'W' : ' ', m_keys.is_key_pressed(Key::S) ? 'S' : ' ',
+            m_rewind.get_used_bytes() / 1024 / 1024, m_rewind.get_num_states(),
+            (m_emulator.m_external->m_ticks - m_rewind.get_first_ticks()) / 4194304, m_clock.get_stats().m_late_frames,
+            m_save_status);
         mvprintw(screen.get_height() / 2, 0, "%s", status.c_str());
+        clrtoeol();  // The save status varies in length
 
         refresh();  // render to terminal
 
@@ -159,18 +180,31 @@ struct App : IKeyReceiver {
 
     bool update() {
         m_keys.update();
+        while (const auto result = m_state_writer.poll()) {
+            m_save_status = result->succeeded() ? "saved" : "failed: " + result->m_error;
+        }
 
         if (m_keys.is_key_pressed(Key::Backspace) && m_rewind.pop_state()) {
-            draw();
+            m_run_ahead.invalidate();
+            draw(m_emulator.get_screen());
             m_clock.sleep_frame(2.0);
             return true;
         }
 
-        if (!m_emulator.run_to_next_frame()) return false;
+        if (!m_run_ahead.run_frame(m_buttons)) return false;
+
+        // Capture fewer frames while fast-forwarding, so the history covers about the same real time
+        m_rewind.set_capture_interval(static_cast<size_t>(std::clamp(m_clock.m_speedup_factor, 1.0, 60.0)));
         m_rewind.push_state();
+        if (m_battery != nullptr) {
+            m_battery->flush();
+        }
 
-        draw();
-        m_clock.sleep_frame();
+        // Skip rendering while catching up on late frames
+        if (!m_catching_up) {
+            draw(m_run_ahead.get_screen());
+        }
+        m_catching_up = m_clock.sleep_frame() == FrameStatus::Late;
 
         return true;
     }
@@ -178,23 +212,56 @@ struct App : IKeyReceiver {
    private:
     std::optional<Screen> m_previous_screen;
     Emulator &m_emulator;
+    BatterySave *m_battery;
     Rewind<Emulator> m_rewind{m_emulator};
+    SpeculativeRunAhead<Emulator> m_run_ahead;
+    u8 m_buttons = 0;  ///< Pushed buttons, bit N is Joypad::Button N
+
+    StateFileWriter m_state_writer;
+    std::string m_save_status;
 
     Clock m_clock;
+    bool m_catching_up = false;
     X11Keys m_keys;
 };
 
 int main(int argc, const char *argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: ./bemugb <rom>" << std::endl;
+    const auto options = Options::parse(argc, argv);
+    if (!options) {
+        std::cerr << "Usage: " << Options::usage(argv[0]) << std::endl;
         return -1;
     }
 
     try {
-        auto cartridge = Cartridge::from_file(argv[1]);
+        auto cartridge = Cartridge::from_file(options->m_rom);
         Emulator emulator{std::move(cartridge)};
-        App app{emulator};
-        while (app.update());
+
+        // Before resuming, so the RAM of a hibernated state wins over the older battery save
+        std::optional<BatterySave> battery;
+        if (emulator.m_cartridge->has_battery() && !emulator.m_cartridge->get_ram().empty()) {
+            battery.emplace(*emulator.m_cartridge, get_battery_save_path(options->m_rom).string());
+        }
+
+        std::filesystem::path hibernation_path;
+        if (!options->m_hibernate_directory.empty()) {
+            hibernation_path = get_hibernation_path(options->m_hibernate_directory, emulator.m_cartridge->header());
+            try {
+                resume_from_hibernation(emulator, hibernation_path);
+            } catch (const std::runtime_error &ex) {
+                std::cerr << "Could not resume, booting instead: " << ex.what() << std::endl;
+            }
+        }
+
+        std::signal(SIGINT, [](int) { g_quit = 1; });
+        std::signal(SIGTERM, [](int) { g_quit = 1; });
+        {
+            App app{emulator, *options, battery ? &*battery : nullptr};
+            while (!g_quit && app.update());
+        }
+
+        if (!hibernation_path.empty()) {
+            hibernate(emulator, hibernation_path);
+        }
     } catch (const std::exception &ex) {
         std::cerr << "Exception: " << ex.what() << std::endl;
         return -1;
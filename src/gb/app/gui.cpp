@@ -3,10 +3,15 @@
 #include <spdlog/spdlog.h>
 
 #include <../../../include/bemu/save/rewind.hpp>
+#include <bemu/gb/battery_save.hpp>
 #include <bemu/gb/cartridge.hpp>
 #include <bemu/gb/clock.hpp>
 #include <bemu/gb/emulator.hpp>
+#include <bemu/gb/options.hpp>
 #include <bemu/gb/screen.hpp>
+#include <bemu/save/hibernate.hpp>
+#include <bemu/save/speculative_run_ahead.hpp>
+#include <csignal>
 #include <magic_enum/magic_enum.hpp>
 #include <mutex>
 #include <thread>
@@ -15,6 +20,9 @@ using namespace bemu;
 using namespace bemu::gb;
 
 namespace {
+/// Set by SIGINT and SIGTERM, to exit cleanly (and hibernate)
+volatile std::sig_atomic_t g_quit = 0;
+
 // std::array g_colors = {olc::Pixel{255, 255, 255}, olc::Pixel{170, 170, 170}, olc::Pixel{85, 85, 85},
 //                        olc::Pixel{0, 0, 0}};
 
@@ -23,37 +31,53 @@ std::array g_colors = {olc::Pixel{155, 188, 15}, olc::Pixel{139, 172, 15}, olc::
 }  // namespace
 
 struct Gui : olc::PixelGameEngine {
-    explicit Gui(Emulator &emulator) : m_emulator(emulator) { sAppName = "Gui"; }
+    /// battery may be null, if the cartridge has no battery save
+    Gui(Emulator &emulator, const Options &options, BatterySave *battery)
+        : m_emulator(emulator),
+          m_battery(battery),
+          m_run_ahead(emulator, options.m_run_ahead_frames, options.m_speculative_threads) {
+        sAppName = "Gui";
+    }
 
     bool OnUserCreate() override { return true; }
 
     bool OnUserUpdate(float) override {
+        if (g_quit) return false;
+
         if (GetKey(olc::Key::BACK).bHeld && m_rewind.pop_state()) {
-            draw();
+            m_run_ahead.invalidate();
+            draw(m_emulator.get_screen());
             m_clock.sleep_frame(2.0);
             return true;
         }
 
-        if (!m_emulator.run_to_next_frame()) return false;
+        // Apply input before running the frame, so run-ahead sees it
+        u8 buttons = 0;
+        set_bit(buttons, Joypad::BUTTON_A, GetKey(olc::Key::Q).bHeld);
+        set_bit(buttons, Joypad::BUTTON_B, GetKey(olc::Key::E).bHeld);
+        set_bit(buttons, Joypad::BUTTON_UP, GetKey(olc::Key::W).bHeld);
+        set_bit(buttons, Joypad::BUTTON_DOWN, GetKey(olc::Key::S).bHeld);
+        set_bit(buttons, Joypad::BUTTON_LEFT, GetKey(olc::Key::A).bHeld);
+        set_bit(buttons, Joypad::BUTTON_RIGHT, GetKey(olc::Key::D).bHeld);
+        set_bit(buttons, Joypad::BUTTON_START, GetKey(olc::Key::X).bHeld);
+        set_bit(buttons, Joypad::BUTTON_SELECT, GetKey(olc::Key::Z).bHeld);
+
+        if (!m_run_ahead.run_frame(buttons)) return false;
         m_rewind.push_state();
+        if (m_battery != nullptr) {
+            m_battery->flush();
+        }
 
-        m_emulator.m_external->m_pending_buttons[Joypad::BUTTON_A] = GetKey(olc::Key::Q).bHeld;
-        m_emulator.m_external->m_pending_buttons[Joypad::BUTTON_B] = GetKey(olc::Key::E).bHeld;
-        m_emulator.m_external->m_pending_buttons[Joypad::BUTTON_UP] = GetKey(olc::Key::W).bHeld;
-        m_emulator.m_external->m_pending_buttons[Joypad::BUTTON_DOWN] = GetKey(olc::Key::S).bHeld;
-        m_emulator.m_external->m_pending_buttons[Joypad::BUTTON_LEFT] = GetKey(olc::Key::A).bHeld;
-        m_emulator.m_external->m_pending_buttons[Joypad::BUTTON_RIGHT] = GetKey(olc::Key::D).bHeld;
-        m_emulator.m_external->m_pending_buttons[Joypad::BUTTON_START] = GetKey(olc::Key::X).bHeld;
-        m_emulator.m_external->m_pending_buttons[Joypad::BUTTON_SELECT] = GetKey(olc::Key::Z).bHeld;
-
-        draw();
-        m_clock.sleep_frame();
+        // Skip rendering while catching up on late frames
+        if (!m_catching_up) {
+            draw(m_run_ahead.get_screen());
+        }
+        m_catching_up = m_clock.sleep_frame() == FrameStatus::Late;
 
         return true;
     }
 
-    void draw() {
-        const auto &s = m_emulator.m_external->m_screen;
+    void draw(const Screen &s) {
         for (int x = 0; x < std::min(ScreenWidth(), static_cast<int>(s.get_width())); x++) {
             for (int y = 0; y < std::min(ScreenHeight(), static_cast<int>(s.get_height())); y++) {
                 Draw(x, y, g_colors[s.get_pixel(x, y)]);
@@ -62,18 +86,22 @@ struct Gui : olc::PixelGameEngine {
     }
 
     Emulator &m_emulator;
+    BatterySave *m_battery;
     Rewind<Emulator> m_rewind{m_emulator};
+    SpeculativeRunAhead<Emulator> m_run_ahead;
     Clock m_clock;
+    bool m_catching_up = false;
 };
 
 int main(int argc, const char *argv[]) {
-    if (argc != 2) {
-        spdlog::critical("Usage: ./bemugb <rom>");
+    const auto options = Options::parse(argc, argv);
+    if (!options) {
+        spdlog::critical("Usage: {}", Options::usage(argv[0]));
         return -1;
     }
     try {
-        spdlog::info("Loading ROM {}", argv[1]);
-        auto cartridge = Cartridge::from_file(argv[1]);
+        spdlog::info("Loading ROM {}", options->m_rom);
+        auto cartridge = Cartridge::from_file(options->m_rom);
         const auto &header = cartridge->header();
 
         spdlog::info("\tTitle          : {}", header.get_title());
@@ -84,9 +112,39 @@ int main(int argc, const char *argv[]) {
                      header.entry[2], header.entry[3]);
 
         Emulator emulator{std::move(cartridge)};
-        Gui gui{emulator};
-        if (gui.Construct(emulator.get_screen().get_width(), emulator.get_screen().get_height(), 4, 4)) {
-            gui.Start();
+
+        // Before resuming, so the RAM of a hibernated state wins over the older battery save
+        std::optional<BatterySave> battery;
+        if (emulator.m_cartridge->has_battery() && !emulator.m_cartridge->get_ram().empty()) {
+            const auto path = get_battery_save_path(options->m_rom);
+            battery.emplace(*emulator.m_cartridge, path.string());
+            spdlog::info("Battery save {}", path.string());
+        }
+
+        std::filesystem::path hibernation_path;
+        if (!options->m_hibernate_directory.empty()) {
+            hibernation_path = get_hibernation_path(options->m_hibernate_directory, header);
+            try {
+                if (resume_from_hibernation(emulator, hibernation_path)) {
+                    spdlog::info("Resumed from {}", hibernation_path.string());
+                }
+            } catch (const std::runtime_error &e) {
+                spdlog::warn("Could not resume, booting instead: {}", e.what());
+            }
+        }
+
+        std::signal(SIGINT, [](int) { g_quit = 1; });
+        std::signal(SIGTERM, [](int) { g_quit = 1; });
+        {
+            Gui gui{emulator, *options, battery ? &*battery : nullptr};
+            if (gui.Construct(emulator.get_screen().get_width(), emulator.get_screen().get_height(), 4, 4)) {
+                gui.Start();
+            }
+        }
+
+        if (!hibernation_path.empty()) {
+            hibernate(emulator, hibernation_path);
+            spdlog::info("Hibernated to {}", hibernation_path.string());
         }
     } catch (const std::exception &e) {
         spdlog::critical(e.what());
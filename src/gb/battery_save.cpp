@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <bemu/gb/battery_save.hpp>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+using namespace bemu;
+using namespace bemu::gb;
+
+namespace {
+size_t get_file_size(const std::string &filename) {
+    std::error_code error;
+    const auto size = std::filesystem::file_size(filename, error);
+    return error ? 0 : static_cast<size_t>(size);
+}
+}  // namespace
+
+// Files larger than the RAM are kept as they are, since other emulators append e.g. the RTC registers
+BatterySave::BatterySave(Cartridge &cartridge, const std::string &filename)
+    : m_cartridge(cartridge), m_file(filename, std::max(get_file_size(filename), cartridge.get_ram().size())) {
+    const auto ram = m_cartridge.get_ram();
+    const auto file = m_file.mutable_data().first(ram.size());
+    std::ranges::copy(file, ram.begin());
+    m_cartridge.get_ram_dirty_pages().clear();
+}
+
+BatterySave::~BatterySave() {
+    try {
+        flush();
+    } catch (...) {
+        // The copied data is written back when the file is unmapped anyway
+    }
+}
+
+void BatterySave::flush() {
+    const auto ram = m_cartridge.get_ram();
+    const auto file = m_file.mutable_data();
+    auto &dirty_pages = m_cartridge.get_ram_dirty_pages();
+
+    // Write back everything changed with one msync(), from the first to the last changed byte
+    size_t begin = ram.size();
+    size_t end = 0;
+    dirty_pages.for_each_dirty_range([&](const size_t offset, const size_t size) {
+        // Loading a state marks every page, but usually changes few of them
+        if (std::memcmp(file.data() + offset, ram.data() + offset, size) != 0) {
+            std::memcpy(file.data() + offset, ram.data() + offset, size);
+            begin = std::min(begin, offset);
+            end = offset + size;
+        }
+    });
+    dirty_pages.clear();
+
+    if (begin < end) {
+        m_file.flush(begin, end - begin);
+    }
+}
@@ -1,18 +1,30 @@
 #include <bemu/gb/bus.hpp>
 #include <bemu/gb/cartridge.hpp>
 #include <bemu/gb/cpu.hpp>
+#include <cstddef>
 
 using namespace bemu;
 using namespace bemu::gb;
 
-Bus::Bus(ICycler &cycler, Cpu &cpu, Cartridge &cartridge, External &external)
+Bus::Bus(MachineState &state, DirtyPages &dirty_pages, ICycler &cycler, Cpu &cpu, Cartridge &cartridge,
+         External &external)
     : MemoryBus(&cycler),
-      m_joypad(external, cpu),
-      m_ppu(external, *this, m_lcd, cpu),
-      m_timer(cpu),
-      m_serial(external) {
+      m_lcd(state.m_lcd),
+      m_joypad(state.m_joypad, external, cpu),
+      m_ppu(state.m_ppu, dirty_pages, offsetof(MachineState, m_ppu), external, *this, m_lcd, cpu),
+      m_timer(state.m_timer, cpu),
+      m_wram_fixed(state.m_wram_fixed, dirty_pages, offsetof(MachineState, m_wram_fixed)),
+      m_wram(state.m_wram, dirty_pages, offsetof(MachineState, m_wram)),
+      m_hram(state.m_hram, dirty_pages, offsetof(MachineState, m_hram)),
+      m_audio(state.m_audio, dirty_pages, offsetof(MachineState, m_audio)),
+      m_wave_pattern(state.m_wave_pattern, dirty_pages, offsetof(MachineState, m_wave_pattern)),
+      m_serial(state.m_serial, external),
+      m_cpu(cpu),
+      m_cartridge(cartridge) {
     add_region(cpu);
     add_region(cartridge);
+    set_cartridge_banks(cartridge.get_banks());
+    cartridge.connect(cycler);
     add_region(m_wram_fixed);
     add_region(m_wram);
     add_region(m_hram);
@@ -25,4 +37,58 @@ Bus::Bus(ICycler &cycler, Cpu &cpu, Cartridge &cartridge, External &external)
     add_region(m_lcd);
     add_region(m_reserved_echo);
     add_region(m_reserved_unused);
+    set_static_map({.m_read = &read_static, .m_write = &write_static});
+}
+
+std::span<const u8> Bus::find_memory(const u16 address) {
+    const auto from = [address](const std::span<const u8> data, const u16 begin) {
+        return data.subspan(address - begin);
+    };
+
+    switch (address >> 12) {
+        case 0xC: return from(m_wram_fixed.data(), 0xC000);
+        case 0xD: return from(m_wram.switchable(), 0xD000);
+        default: return find_cartridge_memory(address);
+    }
+}
+
+template <typename TBus, typename TAccess>
+decltype(auto) Bus::dispatch(TBus &bus, const u16 address, TAccess &&access) {
+    switch (address >> 12) {
+        case 0x8:
+        case 0x9: return access(bus.m_ppu);
+        case 0xC: return access(bus.m_wram_fixed);
+        case 0xD: return access(bus.m_wram);
+        case 0xE: return access(bus.m_reserved_echo);
+        case 0xF: break;
+        default: return access(bus.m_cartridge);  // 0000-7FFF and A000-BFFF
+    }
+
+    if (address <= 0xFDFF) return access(bus.m_reserved_echo);
+    if (address <= 0xFE9F) return access(bus.m_ppu);
+    if (address <= 0xFEFF) return access(bus.m_reserved_unused);
+    if (address == 0xFFFF) return access(bus.m_cpu);
+    if (address >= 0xFF80) return access(bus.m_hram);
+
+    // I/O registers
+    const auto reg = address & 0xFF;
+    if (reg == 0x00) return access(bus.m_joypad);
+    if (reg <= 0x02) return access(bus.m_serial);
+    if (0x04 <= reg && reg <= 0x07) return access(bus.m_timer);
+    if (reg == 0x0F) return access(bus.m_cpu);
+    if (0x10 <= reg && reg <= 0x26) return access(bus.m_audio);
+    if (0x30 <= reg && reg <= 0x3F) return access(bus.m_wave_pattern);
+    if (reg == 0x46) return access(bus.m_ppu);  // OAM DMA
+    if (0x40 <= reg && reg <= 0x4B) return access(bus.m_lcd);
+    if (reg == 0x70) return access(bus.m_wram);
+    return access(bus.m_map);  // Not emulated, the memory map reports it
+}
+
+u8 Bus::read_static(const MemoryBus &bus, const u16 address) {
+    return dispatch(static_cast<const Bus &>(bus), address,
+                    [address](const auto &region) { return region.read(address); });
+}
+
+void Bus::write_static(MemoryBus &bus, const u16 address, const u8 value) {
+    dispatch(static_cast<Bus &>(bus), address, [address, value](auto &region) { region.write(address, value); });
 }
@@ -1,44 +1,112 @@
 #include <spdlog/fmt/fmt.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <bemu/gb/cartridge.hpp>
 #include <bemu/gb/mappers/MBC0.hpp>
 #include <bemu/gb/mappers/MBC1_0.hpp>
 #include <bemu/gb/mappers/MBC3.hpp>
 #include <bemu/gb/mappers/MBC5.hpp>
-#include <fstream>
+#include <bemu/io/mapped_file.hpp>
+#include <filesystem>
 #include <magic_enum/magic_enum.hpp>
+#include <mutex>
+#include <unordered_map>
 
 using namespace bemu;
 using namespace bemu::gb;
 
+namespace {
+/// Map a ROM file, or return the mapping of a cartridge already loaded from it, so all instances of a game share one
+/// image. A file changed on disk is only mapped again once no cartridge uses the old image.
+std::shared_ptr<const MappedFile> map_rom(const std::string& filename) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::weak_ptr<const MappedFile>> roms;
+
+    const auto key = std::filesystem::weakly_canonical(filename).string();
+    const std::lock_guard lock{mutex};
+    auto& entry = roms[key];
+    auto rom = entry.lock();
+    if (!rom) {
+        rom = std::make_shared<const MappedFile>(filename);
+        entry = rom;
+    }
+    return rom;
+}
+}  // namespace
+
 std::string CartridgeHeader::get_title() const { return title; }
 
 const CartridgeHeader& Cartridge::header() const {
-    return *reinterpret_cast<const CartridgeHeader*>(m_data->data() + 0x0100);
+    return *reinterpret_cast<const CartridgeHeader*>(m_rom.data() + 0x0100);
+}
+
+bool Cartridge::has_battery() const {
+    switch (header().cartridge_type) {
+        case CartridgeType::MBC1_RAM_BATTERY:
+        case CartridgeType::MBC2_BATTERY:
+        case CartridgeType::ROM_RAM_BATTERY:
+        case CartridgeType::MMM01_RAM_BATTERY:
+        case CartridgeType::MBC3_TIMER_BATTERY:
+        case CartridgeType::MBC3_TIMER_RAM_BATTERY:
+        case CartridgeType::MBC3_RAM_BATTERY:
+        case CartridgeType::MBC5_RAM_BATTERY:
+        case CartridgeType::MBC5_RUMBLE_RAM_BATTERY:
+        case CartridgeType::MBC7_SENSOR_RUMBLE_RAM_BATTERY:
+        case CartridgeType::HuC1_RAM_BATTERY: return true;
+        default: return false;
+    }
+}
+
+std::span<u8> Cartridge::get_ram() { return get_base_mapper().get_ram(); }
+
+DirtyPages& Cartridge::get_ram_dirty_pages() { return get_base_mapper().get_ram_dirty_pages(); }
+
+const MappedBanks& Cartridge::get_banks() const { return get_base_mapper().get_banks(); }
+
+BaseMapper& Cartridge::get_base_mapper() {
+    return std::visit([](auto& mapper) -> BaseMapper& { return mapper; }, m_mapper);
+}
+
+const BaseMapper& Cartridge::get_base_mapper() const {
+    return std::visit([](const auto& mapper) -> const BaseMapper& { return mapper; }, m_mapper);
+}
+
+Cartridge::Cartridge(const std::span<const u8> rom, std::shared_ptr<const void> rom_owner)
+    : m_rom(rom), m_rom_owner(std::move(rom_owner)), m_mapper(make_mapper(header(), m_rom)) {
+    update_banks();
+}
+
+Cartridge::Cartridge(const Cartridge& other)
+    : IMemoryRegion(other), m_rom(other.m_rom), m_rom_owner(other.m_rom_owner), m_mapper(other.m_mapper) {
+    update_banks();
 }
 
 Cartridge::~Cartridge() = default;
 
-std::unique_ptr<Cartridge> Cartridge::from_file(const std::string& filename) {
-    std::ifstream file{filename, std::ios::binary};
-    if (!file.is_open()) {
-        throw std::runtime_error(fmt::format("Could not open file {}", filename));
-    }
+void Cartridge::connect(const ICycler& clock) {
+    std::visit(
+        [&](auto& mapper) {
+            if constexpr (requires { mapper.connect(clock); }) {
+                mapper.connect(clock);
+            }
+        },
+        m_mapper);
+}
 
-    file.seekg(0, std::ios::end);
-    const unsigned size = file.tellg();
-    file.seekg(0, std::ios::beg);
+void Cartridge::update_banks() {
+    std::visit([](auto& mapper) { mapper.update_banks(); }, m_mapper);
+}
 
+std::unique_ptr<Cartridge> Cartridge::from_file(const std::string& filename) {
+    auto rom = map_rom(filename);
+    const auto size = rom->data().size();
     if (size < 0x0150) {
         throw std::runtime_error(fmt::format("File size {} too small", size));
     }
 
-    auto cartridge = std::make_unique<Cartridge>();
-    cartridge->m_data->resize(size, 0x00);
-    file.read(reinterpret_cast<char*>(cartridge->m_data->data()), size);
-    cartridge->m_mapper = make_mapper(cartridge->header(), *cartridge->m_data);
-    return cartridge;
+    const auto data = rom->data();
+    return std::make_unique<Cartridge>(data, std::move(rom));
 }
 
 std::unique_ptr<Cartridge> Cartridge::from_program_code(const std::vector<u8>& data) {
@@ -60,20 +128,23 @@ std::unique_ptr<Cartridge> Cartridge::from_program_code(const std::vector<u8>& d
     header.rom_size = RomSizeType::Kb32_bank2;
     header.ram_size = RamSizeType::Kb8;
 
-    auto cartridge = std::make_unique<Cartridge>();
-    cartridge->m_data->resize(0x0150 + data.size());
+    // At least the 32 KiB the header declares, so both banks are complete and can be mapped (see MappedBanks)
+    auto rom = std::make_shared<std::vector<u8>>(std::max<size_t>(0x8000, 0x0150 + data.size()));
 
     // Set header
-    reinterpret_cast<CartridgeHeader&>(cartridge->m_data->at(0x0100)) = header;
+    reinterpret_cast<CartridgeHeader&>(rom->at(0x0100)) = header;
 
     // Set data
     for (size_t i = 0; i < data.size(); ++i) {
-        cartridge->m_data->at(0x0150 + i) = data[i];
+        rom->at(0x0150 + i) = data[i];
     }
 
-    cartridge->m_mapper = make_mapper(cartridge->header(), *cartridge->m_data);
+    const std::span<const u8> image = *rom;
+    return std::make_unique<Cartridge>(image, std::move(rom));
+}
 
-    return cartridge;
+std::unique_ptr<Cartridge> Cartridge::clone() const {
+    return std::unique_ptr<Cartridge>(new Cartridge(*this));
 }
 
 bool Cartridge::contains(const u16 address) const {
@@ -81,37 +152,43 @@ bool Cartridge::contains(const u16 address) const {
 }
 
 u8 Cartridge::read(const u16 address) const {
-    if (address < 0x8000) {
-        return m_mapper->read_rom(address);
-    }
-    return m_mapper->read_ram(address);
+    return std::visit(
+        [&](const auto& mapper) { return address < 0x8000 ? mapper.read_rom(address) : mapper.read_ram(address); },
+        m_mapper);
 }
 
 void Cartridge::write(const u16 address, const u8 value) {
-    if (address < 0x8000) {
-        return m_mapper->write_rom(address, value);
-    }
-    return m_mapper->write_ram(address, value);
+    std::visit(
+        [&](auto& mapper) {
+            if (address < 0x8000) {
+                mapper.write_rom(address, value);
+            } else {
+                mapper.write_ram(address, value);
+            }
+        },
+        m_mapper);
 }
 
-std::unique_ptr<IMapper> Cartridge::make_mapper(const CartridgeHeader& header, std::vector<u8>& data) {
+Mapper Cartridge::make_mapper(const CartridgeHeader& header, const std::span<const u8> data) {
     if (header.cartridge_type == CartridgeType::ROM_ONLY) {
-        return std::make_unique<MBC0>(header.rom_size, header.ram_size, data);
+        return MBC0{header.rom_size, header.ram_size, data};
     }
     if (header.cartridge_type == CartridgeType::MBC1 || header.cartridge_type == CartridgeType::MBC1_RAM ||
         header.cartridge_type == CartridgeType::MBC1_RAM_BATTERY && header.rom_size <= RomSizeType::Kb512_bank32) {
-        return std::make_unique<MBC1_0>(header.rom_size, header.ram_size, data);
+        return MBC1_0{header.rom_size, header.ram_size, data};
     }
     if (header.cartridge_type == CartridgeType::MBC3 || header.cartridge_type == CartridgeType::MBC3_RAM ||
-        header.cartridge_type == CartridgeType::MBC3_RAM_BATTERY) {
-        return std::make_unique<MBC3>(header.rom_size, header.ram_size, data);
+        header.cartridge_type == CartridgeType::MBC3_RAM_BATTERY ||
+        header.cartridge_type == CartridgeType::MBC3_TIMER_BATTERY ||
+        header.cartridge_type == CartridgeType::MBC3_TIMER_RAM_BATTERY) {
+        return MBC3{header.rom_size, header.ram_size, data};
     }
     if (header.cartridge_type == CartridgeType::MBC5 || header.cartridge_type == CartridgeType::MBC5_RAM ||
         header.cartridge_type == CartridgeType::MBC5_RAM_BATTERY ||
         header.cartridge_type == CartridgeType::MBC5_RUMBLE ||
         header.cartridge_type == CartridgeType::MBC5_RUMBLE_RAM ||
         header.cartridge_type == CartridgeType::MBC5_RUMBLE_RAM_BATTERY) {
-        return std::make_unique<MBC5>(header.rom_size, header.ram_size, data);
+        return MBC5{header.rom_size, header.ram_size, data};
     }
 
     throw std::runtime_error(fmt::format("Cartridge::make_mapper: unknown cartridge type {}, ROM size {}, RAM size {}",
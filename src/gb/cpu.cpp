@@ -221,7 +221,7 @@ void CpuRegisters::write(const Register16 type, const u16 value) {
     }
 }
 
-Cpu::Cpu() {
+Cpu::Cpu(CpuState &state) : m_state(state), m_registers(state.m_registers) {
     // Loads - [0, 1, 2, 3]x2
     m_instruction_handlers[0x02] = &cpu::ld_r16ind_r8<Register16::BC, Register8::A>;
     m_instruction_handlers[0x12] = &cpu::ld_r16ind_r8<Register16::DE, Register8::A>;
@@ -810,11 +810,11 @@ bool Cpu::contains(const u16 address) const { return address == 0xFFFF || addres
 
 u8 Cpu::read(const u16 address) const {
     if (address == 0xFF0F) {
-        return m_interrupt_request_flags;
+        return m_state.m_interrupt_request_flags;
     }
 
     if (address == 0xFFFF) {
-        return m_interrupt_enable_flags;
+        return m_state.m_interrupt_enable_flags;
     }
 
     return 0xFF;
@@ -822,22 +822,22 @@ u8 Cpu::read(const u16 address) const {
 
 void Cpu::write(const u16 address, const u8 value) {
     if (address == 0xFF0F) {
-        m_interrupt_request_flags = value;
+        m_state.m_interrupt_request_flags = value;
         return;
     }
 
     if (address == 0xFFFF) {
-        m_interrupt_enable_flags = value;
+        m_state.m_interrupt_enable_flags = value;
         return;
     }
 }
 
 void Cpu::set_pending_interrupt(const InterruptType type, const bool pending_interrupt) {
-    set_bit(m_interrupt_request_flags, static_cast<u8>(type), pending_interrupt);
+    set_bit(m_state.m_interrupt_request_flags, static_cast<u8>(type), pending_interrupt);
 }
 
 bool Cpu::has_pending_interrupt() const {
-    return (m_interrupt_request_flags & m_interrupt_enable_flags & 0b11111) != 0;
+    return (m_state.m_interrupt_request_flags & m_state.m_interrupt_enable_flags & 0b11111) != 0;
 }
 
 u8 Cpu::peek_u8() const { return m_memory->peek_u8(m_registers.pc); }
@@ -873,20 +873,20 @@ u16 Cpu::stack_pop16() {
 }
 
 bool Cpu::step() {
-    if (!m_halted) {
+    if (!m_state.m_halted) {
         // Handle interrupts
-        if (m_interrupt_master_enable && has_pending_interrupt()) {
+        if (m_state.m_interrupt_master_enable && has_pending_interrupt()) {
             execute_interrupts();
-            m_set_interrupt_master_enable_next_cycle = false;
+            m_state.m_set_interrupt_master_enable_next_cycle = false;
         } else {
             // Normal instruction
             execute_next_instruction();
 
             // EI (Enable interrupts) delayed.
             // Takes effect after an instruction completes
-            if (m_set_interrupt_master_enable_next_cycle) {
-                m_interrupt_master_enable = true;
-                m_set_interrupt_master_enable_next_cycle = false;
+            if (m_state.m_set_interrupt_master_enable_next_cycle) {
+                m_state.m_interrupt_master_enable = true;
+                m_state.m_set_interrupt_master_enable_next_cycle = false;
             }
         }
     } else {
@@ -895,7 +895,7 @@ bool Cpu::step() {
 
         // Exit halt status on any interrupt, even if not handled
         if (has_pending_interrupt()) {
-            m_halted = false;
+            m_state.m_halted = false;
         }
     }
 
@@ -903,7 +903,8 @@ bool Cpu::step() {
 }
 
 void Cpu::execute_next_instruction() {
-    static u64 last_ticks = 0;
+    // Per thread, since several emulators may run in parallel (e.g. speculative run-ahead)
+    static thread_local u64 last_ticks = 0;
 
     // Get the original state debugging
     u16 pc = m_registers.pc;
@@ -960,12 +961,12 @@ void Cpu::execute_next_instruction() {
 
 void Cpu::execute_interrupts() {
     for (u8 bit = 0; bit < 5; ++bit) {
-        if (get_bit(m_interrupt_request_flags, bit) && get_bit(m_interrupt_enable_flags, bit)) {
+        if (get_bit(m_state.m_interrupt_request_flags, bit) && get_bit(m_state.m_interrupt_enable_flags, bit)) {
             // Clear the interrupt request flag
-            set_bit(m_interrupt_request_flags, bit, false);
+            set_bit(m_state.m_interrupt_request_flags, bit, false);
 
             // Disable interrupts immediately
-            m_interrupt_master_enable = false;
+            m_state.m_interrupt_master_enable = false;
 
             // 2 Wait states (NOPs)
             add_cycle();
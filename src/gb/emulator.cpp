@@ -3,6 +3,7 @@
 #include <bemu/gb/cpu.hpp>
 #include <bemu/gb/emulator.hpp>
 #include <bemu/gb/ppu.hpp>
+#include <bemu/save/snapshot.hpp>
 #include <fstream>
 #include <future>
 #include <thread>
@@ -13,10 +14,29 @@ using namespace bemu::gb;
 Emulator::Emulator(std::unique_ptr<Cartridge> cartridge)
     : m_external(std::make_shared<External>()),
       m_cartridge(std::move(cartridge)),
-      m_bus(*this, m_cpu, *m_cartridge, *m_external) {
+      m_cpu(m_state.m_cpu),
+      m_bus(m_state, m_dirty_pages, *this, m_cpu, *m_cartridge, *m_external) {
     m_cpu.connect(this, &m_bus);
 }
 
+std::unique_ptr<Emulator> Emulator::clone() {
+    auto result = std::make_unique<Emulator>(m_cartridge->clone());
+    clone_into(*result);
+    return result;
+}
+
+void Emulator::clone_into(Emulator &target) {
+    if (!m_cartridge->shares_rom_with(*target.m_cartridge)) {
+        throw std::invalid_argument("Emulator::clone_into: target runs a different ROM");
+    }
+
+    // Components hold references to their parent, so they can't simply be copied. Go through a snapshot instead,
+    // reusing its storage between calls.
+    static thread_local Snapshot snapshot;
+    save_snapshot(*this, snapshot);
+    load_snapshot(target, snapshot);
+}
+
 void Emulator::run() {
     while (m_running) {
         if (!m_cpu.step()) {
@@ -1,3 +1,15 @@
 #include <bemu/gb/external.hpp>
+#include <bemu/utils.hpp>
 
+using namespace bemu;
 using namespace bemu::gb;
+
+void External::set_button(const Joypad::Button button, const bool pushed) { m_pending_buttons[button] = pushed; }
+
+void External::set_buttons(const u8 pushed_mask) {
+    for (u8 button = Joypad::BUTTON_A; button <= Joypad::BUTTON_RIGHT; ++button) {
+        set_button(static_cast<Joypad::Button>(button), get_bit(pushed_mask, button));
+    }
+}
+
+std::unordered_map<Joypad::Button, bool> External::pop_pending_buttons() { return std::exchange(m_pending_buttons, {}); }
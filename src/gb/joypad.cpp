@@ -5,7 +5,8 @@
 using namespace bemu;
 using namespace bemu::gb;
 
-Joypad::Joypad(External& external, Cpu& cpu) : m_external(external), m_cpu(cpu) {}
+Joypad::Joypad(JoypadState& state, External& external, Cpu& cpu)
+    : m_external(external), m_cpu(cpu), m_state(state) {}
 
 bool Joypad::contains(const u16 address) const { return address == 0xFF00; }
 
@@ -14,24 +15,24 @@ u8 Joypad::read(u16) const {
     u8 buttons = 0xF;
 
     if (get_buttons_enabled()) {
-        set_bit(buttons, 0, !m_button_states.m_a);
-        set_bit(buttons, 1, !m_button_states.m_b);
-        set_bit(buttons, 2, !m_button_states.m_select);
-        set_bit(buttons, 3, !m_button_states.m_start);
+        set_bit(buttons, 0, !m_state.m_button_states.m_a);
+        set_bit(buttons, 1, !m_state.m_button_states.m_b);
+        set_bit(buttons, 2, !m_state.m_button_states.m_select);
+        set_bit(buttons, 3, !m_state.m_button_states.m_start);
     } else if (get_d_pad_enabled()) {
-        set_bit(buttons, 0, !m_button_states.m_right);
-        set_bit(buttons, 1, !m_button_states.m_left);
-        set_bit(buttons, 2, !m_button_states.m_up);
-        set_bit(buttons, 3, !m_button_states.m_down);
+        set_bit(buttons, 0, !m_state.m_button_states.m_right);
+        set_bit(buttons, 1, !m_state.m_button_states.m_left);
+        set_bit(buttons, 2, !m_state.m_button_states.m_up);
+        set_bit(buttons, 3, !m_state.m_button_states.m_down);
     }
 
     // Lower nibble is read-only buttons, upper nibble is writable
-    return m_joypad & 0xF0 | buttons;
+    return m_state.m_joypad & 0xF0 | buttons;
 }
 
 void Joypad::write(u16, const u8 value) {
     // The lower nibble is read-only, so only write the top
-    m_joypad = value & 0xF0 | m_joypad & 0x0F;
+    m_state.m_joypad = value & 0xF0 | m_state.m_joypad & 0x0F;
 }
 
 void Joypad::cycle_tick() {
@@ -55,14 +56,14 @@ void Joypad::cycle_tick() {
         current_value = new_value;
     };
 
-    handle_button(m_button_states.m_a, BUTTON_A);
-    handle_button(m_button_states.m_b, BUTTON_B);
-    handle_button(m_button_states.m_start, BUTTON_START);
-    handle_button(m_button_states.m_select, BUTTON_SELECT);
-    handle_button(m_button_states.m_up, BUTTON_UP);
-    handle_button(m_button_states.m_down, BUTTON_DOWN);
-    handle_button(m_button_states.m_left, BUTTON_LEFT);
-    handle_button(m_button_states.m_right, BUTTON_RIGHT);
+    handle_button(m_state.m_button_states.m_a, BUTTON_A);
+    handle_button(m_state.m_button_states.m_b, BUTTON_B);
+    handle_button(m_state.m_button_states.m_start, BUTTON_START);
+    handle_button(m_state.m_button_states.m_select, BUTTON_SELECT);
+    handle_button(m_state.m_button_states.m_up, BUTTON_UP);
+    handle_button(m_state.m_button_states.m_down, BUTTON_DOWN);
+    handle_button(m_state.m_button_states.m_left, BUTTON_LEFT);
+    handle_button(m_state.m_button_states.m_right, BUTTON_RIGHT);
 
     m_external.m_pending_buttons.clear();
 }
@@ -8,15 +8,38 @@
 using namespace bemu;
 using namespace bemu::gb;
 
-bool MemoryMap::contains(u16 address) const {
-    return std::ranges::any_of(m_regions, [&](const auto &region) { return region->contains(address); });
+namespace {
+constexpr bool is_io_register(const u16 address) { return (address & 0xFF80) == 0xFF00 || address == 0xFFFF; }
+
+constexpr size_t io_register_index(const u16 address) { return address == 0xFFFF ? 0x80 : address - 0xFF00; }
+}  // namespace
+
+void MemoryMap::add(IMemoryRegion &region) {
+    m_regions.push_back(&region);
+
+    // As when searching m_regions, regions added earlier take precedence
+    for (size_t i = 0; i < m_io_regions.size(); ++i) {
+        const auto address = static_cast<u16>(i == 0x80 ? 0xFFFF : 0xFF00 + i);
+        if (m_io_regions[i] == nullptr && region.contains(address)) {
+            m_io_regions[i] = &region;
+        }
+    }
+}
+
+IMemoryRegion *MemoryMap::find_region(const u16 address) const {
+    if (is_io_register(address)) {
+        return m_io_regions[io_register_index(address)];
+    }
+
+    const auto it = std::ranges::find_if(m_regions, [&](const auto &region) { return region->contains(address); });
+    return it != m_regions.end() ? *it : nullptr;
 }
 
+bool MemoryMap::contains(const u16 address) const { return find_region(address) != nullptr; }
+
 u8 MemoryMap::read(const u16 address) const {
-    for (const auto &region : m_regions) {
-        if (region->contains(address)) {
-            return region->read(address);
-        }
+    if (const auto region = find_region(address)) {
+        return region->read(address);
     }
 
     // throw std::runtime_error(fmt::format("Address not mapped (read): 0x{:04x}", address));
@@ -25,11 +48,9 @@ u8 MemoryMap::read(const u16 address) const {
 }
 
 void MemoryMap::write(const u16 address, const u8 value) {
-    for (const auto &region : m_regions) {
-        if (region->contains(address)) {
-            region->write(address, value);
-            return;
-        }
+    if (const auto region = find_region(address)) {
+        region->write(address, value);
+        return;
     }
 
     // throw std::runtime_error(fmt::format("Address not mapped (write): 0x{:04x}", address));
@@ -38,9 +59,38 @@ void MemoryMap::write(const u16 address, const u8 value) {
 
 MemoryBus::MemoryBus(ICycler *cycler) : m_cycler(cycler) {}
 
-void MemoryBus::add_region(IMemoryRegion &region) { m_map.m_regions.push_back(&region); }
+void MemoryBus::add_region(IMemoryRegion &region) { m_map.add(region); }
+
+u8 MemoryBus::peek_u8(const u16 address) const {
+    if (m_cartridge_banks != nullptr) {
+        if (address <= 0x7FFF) {
+            const auto bank = address <= 0x3FFF ? m_cartridge_banks->m_rom_bank_0 : m_cartridge_banks->m_rom_bank_n;
+            if (bank != nullptr) {
+                return bank[address & 0x3FFF];
+            }
+        } else if ((address & 0xE000) == 0xA000 && m_cartridge_banks->m_ram_bank != nullptr) {
+            return m_cartridge_banks->m_ram_bank[address & 0x1FFF];
+        }
+    }
+
+    return m_static_map.m_read != nullptr ? m_static_map.m_read(*this, address) : m_map.read(address);
+}
 
-u8 MemoryBus::peek_u8(const u16 address) const { return m_map.read(address); }
+std::span<const u8> MemoryBus::find_cartridge_memory(const u16 address) const {
+    if (m_cartridge_banks == nullptr) {
+        return {};
+    }
+
+    if (address <= 0x7FFF) {
+        const auto bank = address <= 0x3FFF ? m_cartridge_banks->m_rom_bank_0 : m_cartridge_banks->m_rom_bank_n;
+        if (bank == nullptr) return {};
+        return {bank + (address & 0x3FFF), 0x4000 - static_cast<size_t>(address & 0x3FFF)};
+    }
+    if ((address & 0xE000) == 0xA000 && m_cartridge_banks->m_ram_bank != nullptr) {
+        return {m_cartridge_banks->m_ram_bank + (address & 0x1FFF), 0x2000 - static_cast<size_t>(address & 0x1FFF)};
+    }
+    return {};
+}
 
 u16 MemoryBus::peek_u16(const u16 address) const {
     const auto lo = peek_u8(address);
@@ -62,7 +112,35 @@ u16 MemoryBus::read_u16(const u16 address) const {
     return combine_bytes(hi, lo);
 }
 
-void MemoryBus::emplace_u8(const u16 address, const u8 value) { m_map.write(address, value); }
+bool MemoryBus::write_cartridge_ram(const u16 address, const u8 value) {
+    if (m_cartridge_banks == nullptr || m_cartridge_banks->m_ram_bank == nullptr || (address & 0xE000) != 0xA000) {
+        return false;
+    }
+
+    const auto index = address & 0x1FFF;
+    m_cartridge_banks->m_ram_bank[index] = value;
+    m_cartridge_banks->m_ram_dirty_pages->mark(m_cartridge_banks->m_ram_bank_offset + index);
+    return true;
+}
+
+void MemoryBus::write_region(const u16 address, const u8 value) {
+    // Writes to the mapper registers, or to SVBK, may switch banks
+    if (address <= 0x7FFF || address == 0xFF70) {
+        ++m_bank_switch_count;
+    }
+
+    if (m_static_map.m_write != nullptr) {
+        m_static_map.m_write(*this, address, value);
+    } else {
+        m_map.write(address, value);
+    }
+}
+
+void MemoryBus::emplace_u8(const u16 address, const u8 value) {
+    if (!write_cartridge_ram(address, value)) {
+        write_region(address, value);
+    }
+}
 
 void MemoryBus::emplace_u16(const u16 address, const u16 value) {
     auto [hi, lo] = split_bytes(value);
@@ -71,7 +149,9 @@ void MemoryBus::emplace_u16(const u16 address, const u16 value) {
 }
 
 void MemoryBus::write_u8(const u16 address, const u8 value) {
-    m_map.write(address, value);
+    if (!write_cartridge_ram(address, value)) {
+        write_region(address, value);
+    }
     if (m_cycler) {
         m_cycler->add_cycles();
     }
@@ -7,6 +7,7 @@
 #include <bemu/gb/lcd.hpp>
 #include <bemu/gb/ppu.hpp>
 #include <bemu/gb/screen.hpp>
+#include <cstddef>
 #include <stdexcept>
 
 using namespace bemu;
@@ -39,37 +40,51 @@ u8 decode_palette(const u8 palette, const u8 id) { return (palette >> (2 * id))
 
 bool DmaState::contains(const u16 address) const { return address == 0xFF46; }
 
-u8 DmaState::read(u16) const { return m_written_value; }
+u8 DmaState::read(u16) const { return m_state.m_written_value; }
 
 void DmaState::write(u16, const u8 value) {
-    m_active = true;
-    m_written_value = value;
-    m_current_byte = 0;
-    m_start_delay = 2;
+    m_state.m_active = true;
+    m_state.m_written_value = value;
+    m_state.m_current_byte = 0;
+    m_state.m_start_delay = 2;
+    reset_source();
 }
 
 void DmaState::cycle_tick() {
-    if (!m_active) return;
+    if (!m_state.m_active) return;
 
-    if (m_start_delay > 0) {
-        --m_start_delay;
+    if (m_state.m_start_delay > 0) {
+        --m_state.m_start_delay;
         return;
     }
 
-    const auto source_address = 0x100 * m_written_value + m_current_byte;
-    const auto destination_address = 0xFE00 + m_current_byte;
-    ++m_current_byte;
+    const auto index = m_state.m_current_byte++;
+    if (index == sizeof(OamRamData)) {
+        m_state.m_active = false;
+        return;
+    }
 
-    const auto data = m_bus.peek_u8(source_address);
-    if (!m_oam.contains(destination_address)) {
-        m_active = false;
-    } else {
-        m_oam.write(destination_address, data);
+    const auto source_address = 0x100 * m_state.m_written_value;
+    if (!m_source_resolved || m_source_bank_switch_count != m_bus.get_bank_switch_count()) {
+        m_source = m_bus.find_memory(source_address);
+        m_source_resolved = true;
+        m_source_bank_switch_count = m_bus.get_bank_switch_count();
     }
+
+    const auto data = index < m_source.size() ? m_source[index] : m_bus.peek_u8(source_address + index);
+    m_oam.write_byte(index, data);
 }
 
-Ppu::Ppu(External &external, Bus &bus, Lcd &lcd, Cpu &cpu)
-    : m_external(external), m_bus(bus), m_lcd(lcd), m_cpu(cpu), m_oam_dma(m_bus, m_oam) {}
+Ppu::Ppu(PpuState &state, DirtyPages &dirty_pages, const size_t offset, External &external, Bus &bus, Lcd &lcd,
+         Cpu &cpu)
+    : m_external(external),
+      m_bus(bus),
+      m_lcd(lcd),
+      m_cpu(cpu),
+      m_state(state),
+      m_vram(state.m_vram, dirty_pages, offset + offsetof(PpuState, m_vram)),
+      m_oam(state.m_oam, dirty_pages, offset + offsetof(PpuState, m_oam)),
+      m_oam_dma(m_bus, m_oam, state.m_oam_dma) {}
 
 bool Ppu::contains(const u16 address) const {
     return m_oam_dma.contains(address) || m_oam.contains(address) || m_vram.contains(address);
@@ -128,14 +143,14 @@ void Ppu::write(const u16 address, const u8 value) {
 }
 
 void Ppu::dot_tick() {
-    m_frame_tick++;
-    m_frame_tick %= dots_per_frame;
+    m_state.m_frame_tick++;
+    m_state.m_frame_tick %= dots_per_frame;
 
     // Handle current tick
     dot_tick_handle_and_get_next_mode();
 
     // Enter new frame
-    if (m_frame_tick == 0) {
+    if (m_state.m_frame_tick == 0) {
         m_external.m_frame_number++;
     }
 
@@ -155,7 +170,7 @@ void Ppu::dot_tick_handle_and_get_next_mode() {
     const auto y = get_line_number();
 
     // Start of VBlank period
-    if (m_frame_tick == screen_height * dots_per_line - 1) {
+    if (m_state.m_frame_tick == screen_height * dots_per_line - 1) {
         m_lcd.set_ppu_mode(PpuMode::VerticalBlank);
         m_cpu.set_pending_interrupt(InterruptType::VBlank);
         if (m_lcd.is_vertical_blank_interrupt_enabled()) {
@@ -165,7 +180,7 @@ void Ppu::dot_tick_handle_and_get_next_mode() {
     }
 
     // If we're in vblank, then we don't transition until we're back at tick 0
-    if (m_lcd.get_ppu_mode() == PpuMode::VerticalBlank && m_frame_tick != 0) return;
+    if (m_lcd.get_ppu_mode() == PpuMode::VerticalBlank && m_state.m_frame_tick != 0) return;
 
     if (line_tick == 0) {
         // Start of Mode 2: OAM scan
@@ -211,7 +226,7 @@ std::optional<PpuMode> Ppu::dot_tick_horizontal_blank() {
 }
 
 std::optional<PpuMode> Ppu::dot_tick_vertical_blank() {
-    if (m_frame_tick >= dots_per_frame - 1) {
+    if (m_state.m_frame_tick >= dots_per_frame - 1) {
         return PpuMode::OamScan;
     }
 
@@ -246,9 +261,9 @@ std::optional<PpuMode> Ppu::dot_tick_draw() {
     return std::nullopt;
 }
 
-u16 Ppu::get_line_tick() const { return m_frame_tick % dots_per_line; }
+u16 Ppu::get_line_tick() const { return m_state.m_frame_tick % dots_per_line; }
 
-u16 Ppu::get_line_number() const { return m_frame_tick / dots_per_line; }
+u16 Ppu::get_line_number() const { return m_state.m_frame_tick / dots_per_line; }
 
 std::vector<const OamEntry *> Ppu::load_line_objects() {
     std::vector<const OamEntry *> line_objects;
@@ -279,7 +294,7 @@ std::vector<const OamEntry *> Ppu::load_line_objects() {
 }
 
 void Ppu::render_scanline() {
-    if (!m_lcd.get_enable_lcd_and_ppu()) return;
+    if (!m_lcd.get_enable_lcd_and_ppu() || m_external.m_skip_rendering) return;
 
     if (m_lcd.get_background_and_window_enable()) {
         render_scanline_background();
@@ -13,10 +13,10 @@ bool Timer::contains(const u16 address) const { return 0xFF04 <= address && addr
 
 [[nodiscard]] u8 Timer::read(const u16 address) const {
     switch (address) {
-        case 0xFF04: return div >> 8;
-        case 0xFF05: return tima;
-        case 0xFF06: return tma;
-        case 0xFF07: return tac;
+        case 0xFF04: return m_state.div >> 8;
+        case 0xFF05: return m_state.tima;
+        case 0xFF06: return m_state.tma;
+        case 0xFF07: return m_state.tac;
         default: throw std::runtime_error("Invalid timer memory access");
     }
 }
@@ -39,19 +39,19 @@ void Timer::write(const u16 address, const u8 value) {
     switch (address) {
         case 0xFF04: {
             /// Writing any value to this register resets it to $00
-            div = 0x00;
+            m_state.div = 0x00;
             break;
         }
         case 0xFF05: {
-            tima = value;
+            m_state.tima = value;
             break;
         }
         case 0xFF06: {
-            tma = value;
+            m_state.tma = value;
             break;
         }
         case 0xFF07: {
-            tac = value;
+            m_state.tac = value;
             break;
         }
         default: throw std::runtime_error("Invalid timer memory access");
@@ -60,27 +60,27 @@ void Timer::write(const u16 address, const u8 value) {
 
 void Timer::dot_tick() {
     // DIV counts regardless of whether the timer is enabled or not
-    const u16 prev_div = div;
-    div++;
+    const u16 prev_div = m_state.div;
+    m_state.div++;
 
     // Skip if not enabled
-    const bool enabled = get_bit(tac, 2);
+    const bool enabled = get_bit(m_state.tac, 2);
 
     // Get which bit of DIV we are using as the timer clock
     // See https://gbdev.io/pandocs/Timer_and_Divider_Registers.html#timer-and-divider-registers
     // Counts on falling edge, see https://gbdev.io/pandocs/Timer_Obscure_Behaviour.html
-    const u8 clock_select = tac & 0b11;
+    const u8 clock_select = m_state.tac & 0b11;
     const u8 bit_number = g_clock_select_to_bit_number[clock_select];
-    const bool bit_switched = get_bit(prev_div, bit_number) && !get_bit(div, bit_number);
+    const bool bit_switched = get_bit(prev_div, bit_number) && !get_bit(m_state.div, bit_number);
 
-    if (m_overflowed) {
-        m_overflowed = false;
-        tima = tma;
+    if (m_state.m_overflowed) {
+        m_state.m_overflowed = false;
+        m_state.tima = m_state.tma;
         m_cpu.set_pending_interrupt(InterruptType::Timer);
     } else if (bit_switched && enabled) {
-        tima++;
-        if (tima == 0x00) {
-            m_overflowed = true;
+        m_state.tima++;
+        if (m_state.tima == 0x00) {
+            m_state.m_overflowed = true;
         }
     }
 }
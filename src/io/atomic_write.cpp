@@ -0,0 +1,77 @@
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <bemu/io/atomic_write.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+using namespace bemu;
+
+#ifdef _WIN32
+void bemu::write_file_atomically(const std::string &filename, const std::span<const u8> data) {
+    const auto temp_filename = filename + ".tmp";
+    const auto file =
+        CreateFileA(temp_filename.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not create " + temp_filename);
+    }
+
+    size_t written = 0;
+    bool ok = true;
+    while (ok && written < data.size()) {
+        DWORD chunk = 0;
+        const auto size = static_cast<DWORD>(std::min<size_t>(data.size() - written, 1 << 30));
+        ok = WriteFile(file, data.data() + written, size, &chunk, nullptr) != 0;
+        written += chunk;
+    }
+    ok = ok && FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+
+    if (!ok || !MoveFileExA(temp_filename.c_str(), filename.c_str(),
+                            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileA(temp_filename.c_str());
+        throw std::runtime_error("Could not write " + filename);
+    }
+}
+#else
+void bemu::write_file_atomically(const std::string &filename, const std::span<const u8> data) {
+    const auto temp_filename = filename + ".tmp";
+    const auto fd = open(temp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not create " + temp_filename);
+    }
+
+    size_t written = 0;
+    bool ok = true;
+    while (ok && written < data.size()) {
+        const auto result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno == EINTR) continue;
+        ok = result > 0;
+        written += ok ? static_cast<size_t>(result) : 0;
+    }
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+
+    if (!ok || std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+        std::remove(temp_filename.c_str());
+        throw std::runtime_error("Could not write " + filename);
+    }
+
+    // Persist the rename itself
+    auto directory = std::filesystem::path{filename}.parent_path();
+    if (directory.empty()) directory = ".";
+    if (const auto dir_fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+}
+#endif
@@ -0,0 +1,166 @@
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <bemu/io/mapped_file.hpp>
+#include <stdexcept>
+
+using namespace bemu;
+
+#ifdef _WIN32
+namespace {
+/// Map the whole of file, which is closed either way
+void *map_file(const HANDLE file, const bool writable, void *&handle) {
+    handle = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);  // The mapping keeps the file open
+    if (handle == nullptr) {
+        return nullptr;
+    }
+
+    const auto data = MapViewOfFile(handle, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        CloseHandle(handle);
+        handle = nullptr;
+    }
+    return data;
+}
+}  // namespace
+
+MappedFile::MappedFile(const std::string &filename) {
+    const auto file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open " + filename);
+    }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not get the size of " + filename);
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    if (m_size == 0) {
+        CloseHandle(file);
+        return;  // Empty files cannot be mapped
+    }
+
+    m_data = static_cast<u8 *>(map_file(file, false, m_handle));
+    if (m_data == nullptr) {
+        throw std::runtime_error("Could not map " + filename);
+    }
+}
+
+MappedFile::MappedFile(const std::string &filename, const size_t size) : m_size(size), m_writable(true) {
+    const auto file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                                  OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open " + filename);
+    }
+
+    LARGE_INTEGER end{};
+    end.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not resize " + filename);
+    }
+    if (m_size == 0) {
+        CloseHandle(file);
+        return;  // Empty files cannot be mapped
+    }
+
+    m_data = static_cast<u8 *>(map_file(file, true, m_handle));
+    if (m_data == nullptr) {
+        throw std::runtime_error("Could not map " + filename);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_handle != nullptr) {
+        CloseHandle(m_handle);
+    }
+}
+
+void MappedFile::flush(const size_t offset, const size_t size) {
+    if (m_writable && size != 0 && !FlushViewOfFile(m_data + offset, size)) {
+        throw std::runtime_error("Could not flush a mapped file");
+    }
+}
+#else
+MappedFile::MappedFile(const std::string &filename) {
+    const auto fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + filename);
+    }
+
+    struct stat status{};
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not get the size of " + filename);
+    }
+    m_size = static_cast<size_t>(status.st_size);
+    if (m_size == 0) {
+        close(fd);
+        return;  // Empty files cannot be mapped
+    }
+
+    const auto data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps the file open
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Could not map " + filename);
+    }
+    m_data = static_cast<u8 *>(data);
+}
+
+MappedFile::MappedFile(const std::string &filename, const size_t size) : m_size(size), m_writable(true) {
+    const auto fd = open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + filename);
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not resize " + filename);
+    }
+    if (m_size == 0) {
+        close(fd);
+        return;  // Empty files cannot be mapped
+    }
+
+    // Shared, so writes go to the file
+    const auto data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Could not map " + filename);
+    }
+    m_data = static_cast<u8 *>(data);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) {
+        munmap(m_data, m_size);
+    }
+}
+
+void MappedFile::flush(const size_t offset, const size_t size) {
+    if (!m_writable || size == 0) {
+        return;
+    }
+
+    // msync() needs a page aligned address
+    static const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const auto start = offset / page_size * page_size;
+    if (msync(m_data + start, offset + size - start, MS_ASYNC) != 0) {
+        throw std::runtime_error("Could not flush a mapped file");
+    }
+}
+#endif
@@ -0,0 +1,85 @@
+#include <bemu/gb/cartridge.hpp>
+#include <bemu/gb/memory.hpp>
+
+#include "test_helpers.hpp"
+
+using namespace bemu;
+using namespace bemu::gb;
+using namespace bemu::gb::test;
+
+namespace {
+bool test_mapped_banks() {
+    bool result = true;
+    for (const auto type : {CartridgeType::MBC1_RAM, CartridgeType::MBC3_RAM, CartridgeType::MBC5_RAM}) {
+        auto cartridge = make_banked_cartridge(type);
+        MemoryBus bus;
+        bus.add_region(*cartridge);
+        bus.set_cartridge_banks(cartridge->get_banks());
+        const auto matches_mapper = [&](const u16 address) { return bus.peek_u8(address) == cartridge->read(address); };
+
+        bus.write_u8(0x0000, 0x0A);  // Enable RAM
+        bus.write_u8(0x2000, 0x03);  // ROM bank 3
+        bus.write_u8(0x4000, 0x02);  // RAM bank 2
+        bus.write_u8(0xA010, 0x55);
+        result &= check(bus.peek_u8(0x4000) == 3 && matches_mapper(0x4000) && matches_mapper(0x0150),
+                        "switched ROM bank is mapped");
+        result &= check(cartridge->get_ram()[2 * 0x2000 + 0x10] == 0x55 && matches_mapper(0xA010),
+                        "switched RAM bank is mapped");
+
+        bus.write_u8(0x0000, 0x00);  // Disable RAM
+        result &= check(cartridge->get_banks().m_ram_bank == nullptr && matches_mapper(0xA010),
+                        "disabled RAM goes through the mapper");
+
+        // The clone maps its own copy of the RAM
+        auto clone = cartridge->clone();
+        MemoryBus clone_bus;
+        clone_bus.add_region(*clone);
+        clone_bus.set_cartridge_banks(clone->get_banks());
+        clone_bus.write_u8(0x0000, 0x0A);
+        clone_bus.write_u8(0xA010, 0x99);
+        bus.write_u8(0x0000, 0x0A);
+        result &= check(clone_bus.peek_u8(0xA010) == 0x99 && bus.peek_u8(0xA010) == 0x55,
+                        "clone writes its own RAM");
+    }
+    return result;
+}
+
+bool test_real_time_clock() {
+    using Rtc = RealTimeClock;
+    Rtc clock;
+    clock.write(Rtc::Seconds, 59, 0);
+    clock.write(Rtc::Minutes, 59, 0);
+    clock.write(Rtc::Hours, 23, 0);
+    clock.write(Rtc::DaysLow, 0xFF, 0);
+    clock.write(Rtc::DaysHigh, 0x01, 0);
+    clock.latch(Rtc::dots_per_second);
+    bool result = check(clock.read(Rtc::Seconds) == 0 && clock.read(Rtc::Hours) == 0 && clock.read(Rtc::DaysLow) == 0 &&
+                            clock.read(Rtc::DaysHigh) == Rtc::days_high_carry,
+                        "clock carries past day 511");
+
+    clock.write(Rtc::DaysHigh, Rtc::days_high_halt, Rtc::dots_per_second);
+    clock.latch(10 * Rtc::dots_per_second);
+    result &= check(clock.read(Rtc::Seconds) == 0, "halted clock stands still");
+
+    // Advancing in one step, e.g. after fast-forwarding, matches advancing every frame
+    Rtc stepped;
+    Rtc jumped;
+    stepped.write(Rtc::Seconds, 62, 0);  // Out of range: wraps after 2 seconds, without carrying
+    jumped.write(Rtc::Seconds, 62, 0);
+    constexpr u64 duration = 3 * 24 * 3600 * Rtc::dots_per_second + 12345;
+    for (u64 now = 0; now < duration; now += 70224 * 60) {
+        stepped.sync(now);
+    }
+    stepped.latch(duration);
+    jumped.latch(duration);
+    result &= check(stepped.m_latched == jumped.m_latched && jumped.read(Rtc::DaysLow) == 2, "clock advances exactly");
+    return result;
+}
+}  // namespace
+
+int main() {
+    bool result = test_mapped_banks();
+    result &= test_real_time_clock();
+
+    return result ? 0 : 1;
+}
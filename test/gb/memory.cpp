@@ -0,0 +1,151 @@
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <bemu/gb/emulator.hpp>
+#include <bemu/save/snapshot.hpp>
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "test_helpers.hpp"
+
+using namespace bemu;
+using namespace bemu::gb;
+using namespace bemu::gb::test;
+
+namespace {
+bool test_oam_dma() {
+    auto emulator = make_emulator(0);
+    auto &bus = emulator->m_bus;
+    std::vector<u8> expected;
+    for (u16 i = 0; i < sizeof(OamRamData); ++i) {
+        expected.push_back(static_cast<u8>(i ^ 0x5A));
+        bus.emplace_u8(0xC000 + i, expected.back());
+        bus.emplace_u8(0xD000 + i, 0xEE);
+    }
+
+    const auto run_cycles = [&](const int cycles) {
+        for (int i = 0; i < cycles; ++i) emulator->add_cycles();
+    };
+    bus.emplace_u8(0xFF46, 0xC0);
+    run_cycles(10);
+    Snapshot snapshot;
+    save_snapshot(*emulator, snapshot);
+
+    // Loading the snapshot must also restore the source of the transfer, which is resolved once
+    bus.emplace_u8(0xFF46, 0xD0);
+    run_cycles(10);
+    load_snapshot(*emulator, snapshot);
+    run_cycles(200);
+
+    const auto &oam = emulator->m_state.m_ppu.m_oam;
+    bool result = check(!emulator->m_state.m_ppu.m_oam_dma.m_active &&
+                            std::memcmp(&oam, expected.data(), expected.size()) == 0,
+                        "OAM DMA copies its source");
+
+    // Switching the source bank halfway through, the rest of the transfer reads the new bank. Through the static memory
+    // map, and the memory map it replaces.
+    for (const bool static_map : {true, false}) {
+        emulator = std::make_unique<Emulator>(make_banked_cartridge(CartridgeType::MBC5_RAM, make_program()));
+        auto &banked_bus = emulator->m_bus;
+        if (!static_map) {
+            banked_bus.set_static_map({});
+        }
+        for (const u8 bank : {1, 2}) {
+            banked_bus.emplace_u8(0xFF70, bank);
+            for (u16 i = 0; i < sizeof(OamRamData); ++i) {
+                banked_bus.emplace_u8(0xD000 + i, 0x10 * bank);
+            }
+        }
+        const auto oam_bytes = [&] { return reinterpret_cast<const u8 *>(&emulator->m_state.m_ppu.m_oam); };
+        const auto transfer = [&](const u8 source, const u16 bank_register, const u8 bank) {
+            banked_bus.emplace_u8(0xFF46, source);
+            run_cycles(2 + 80);  // Start delay, then half of the bytes
+            banked_bus.emplace_u8(bank_register, bank);
+            run_cycles(100);
+            return std::pair{oam_bytes()[79], oam_bytes()[80]};
+        };
+        const auto map_name = static_map ? "static memory map" : "memory map";
+        result &= check(transfer(0x40, 0x2000, 3) == std::pair<u8, u8>{1, 3},
+                        fmt::format("OAM DMA follows ROM bank switches ({})", map_name));
+        banked_bus.emplace_u8(0xFF70, 1);
+        result &= check(transfer(0xD0, 0xFF70, 2) == std::pair<u8, u8>{0x10, 0x20},
+                        fmt::format("OAM DMA follows WRAM bank switches ({})", map_name));
+    }
+    return result;
+}
+
+bool test_io_register_table() {
+    auto emulator = make_emulator(0);
+    const auto &map = emulator->m_bus.get_map();
+    bool matches = true;
+    for (u32 address = 0xFF00; address <= 0xFFFF; ++address) {
+        if (0xFF80 <= address && address < 0xFFFF) continue;  // HRAM, not I/O registers
+
+        const auto it =
+            std::ranges::find_if(map.m_regions, [&](const auto *region) { return region->contains(address); });
+        matches &= map.find_region(address) == (it != map.m_regions.end() ? *it : nullptr);
+    }
+    return check(matches, "I/O register table matches the first region containing each register");
+}
+
+bool test_static_memory_map() {
+    auto emulator = make_emulator();
+    auto reference = std::make_unique<Emulator>(Cartridge::from_program_code(make_program()));
+    reference->m_bus.set_static_map({});  // Search the regions added to the memory map instead
+    for (size_t i = 0; i < 10; ++i) {
+        reference->run_to_next_frame();
+    }
+    return check(get_state(*emulator) == get_state(*reference), "static memory map matches the memory map");
+}
+
+bool test_static_memory_map_accesses() {
+    auto emulator = make_emulator();
+    auto banked = std::make_unique<Emulator>(make_banked_cartridge(CartridgeType::MBC5_RAM, make_program()));
+    auto reference = banked->clone();
+    reference->m_bus.set_static_map({});
+    // Unmapped addresses are logged through either map. Cpu sets the level, so silence them after creating it.
+    spdlog::set_level(spdlog::level::off);
+
+    // Reading every address through the static memory map, and through the memory map
+    const auto &map = emulator->m_bus.get_map();
+    std::optional<u16> read_mismatch;
+    for (u32 address = 0x0000; address <= 0xFFFF && !read_mismatch; ++address) {
+        if (Bus::read_static(emulator->m_bus, address) != map.read(address)) {
+            read_mismatch = address;
+        }
+    }
+    bool result = check(!read_mismatch, fmt::format("static memory map reads 0x{:04x} as the memory map does",
+                                                    read_mismatch.value_or(0)));
+
+    // Writing every address through the static memory map, and through the memory map of the reference. Cartridge RAM
+    // is enabled first, so the reference writes it directly, as the bus does.
+    std::optional<u16> write_mismatch;
+    for (u32 address = 0x0000; address <= 0xFFFF && !write_mismatch; ++address) {
+        const auto value = static_cast<u8>(address < 0x2000 ? 0x0A : address ^ 0x5A);
+        Bus::write_static(banked->m_bus, address, value);
+        reference->m_bus.emplace_u8(address, value);
+        if (std::memcmp(&banked->m_state, &reference->m_state, sizeof(MachineState)) != 0 ||
+            !std::ranges::equal(banked->m_cartridge->get_ram(), reference->m_cartridge->get_ram())) {
+            write_mismatch = address;
+        }
+    }
+    result &= check(!write_mismatch && get_state(*banked) == get_state(*reference),
+                    fmt::format("static memory map writes 0x{:04x} as the memory map does",
+                                write_mismatch.value_or(0)));
+
+    spdlog::set_level(spdlog::level::info);
+    return result;
+}
+}  // namespace
+
+int main() {
+    bool result = test_oam_dma();
+    result &= test_io_register_table();
+    result &= test_static_memory_map();
+    result &= test_static_memory_map_accesses();
+
+    return result ? 0 : 1;
+}
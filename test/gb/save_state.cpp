@@ -0,0 +1,625 @@
+#include <bemu/gb/battery_save.hpp>
+#include <bemu/gb/cartridge.hpp>
+#include <bemu/gb/emulator.hpp>
+#include <bemu/save/delta.hpp>
+#include <bemu/save/file.hpp>
+#include <bemu/save/hibernate.hpp>
+#include <bemu/save/lz.hpp>
+#include <bemu/save/page_store.hpp>
+#include <bemu/save/rewind.hpp>
+#include <bemu/save/run_ahead.hpp>
+#include <bemu/save/snapshot.hpp>
+#include <bemu/save/speculative_run_ahead.hpp>
+#include <bemu/save/state_file_writer.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "test_helpers.hpp"
+
+using namespace bemu;
+using namespace bemu::gb;
+using namespace bemu::gb::test;
+
+namespace {
+bool test_snapshot_round_trip() {
+    auto emulator = make_emulator();
+
+    Snapshot snapshot;
+    save_snapshot(*emulator, snapshot);
+    const auto before = get_state(*emulator);
+
+    emulator->run_to_next_frame();
+    emulator->run_to_next_frame();
+    const auto after = get_state(*emulator);
+
+    load_snapshot(*emulator, snapshot);
+    bool result = check(get_state(*emulator) == before, "snapshot restores state");
+
+    emulator->run_to_next_frame();
+    emulator->run_to_next_frame();
+    result &= check(get_state(*emulator) == after, "emulation after restore is deterministic");
+    return result;
+}
+
+/// The portable serialize() must cover the same state as the raw MachineState snapshot
+bool test_serialize_matches_snapshot() {
+    auto emulator = make_emulator();
+
+    std::vector<u8> data;
+    auto output = detail::VectorOutputBuffer{data};
+    auto output_archive = StateOutputArchive{output};
+    emulator->serialize(output_archive);
+
+    auto restored = std::make_unique<Emulator>(Cartridge::from_program_code(make_program()));
+    auto input = detail::VectorInputBuffer{data};
+    auto input_archive = StateInputArchive{input};
+    restored->serialize(input_archive);
+
+    return check(get_state(*restored) == get_state(*emulator), "serialize() restores the whole machine state");
+}
+
+bool test_delta() {
+    std::vector<u8> base(1000);
+    for (size_t i = 0; i < base.size(); ++i) {
+        base[i] = static_cast<u8>(i * 7);
+    }
+
+    const auto round_trip = [&](const std::vector<u8> &data) {
+        std::vector<u8> delta;
+        encode_delta(base, data, delta);
+
+        std::vector<u8> decoded{1, 2, 3};
+        decode_delta(base, delta, decoded);
+        return decoded == data;
+    };
+
+    auto changed = base;
+    changed[0] ^= 1;
+    changed[500] ^= 1;
+    changed[505] ^= 1;
+    for (size_t i = 600; i < 700; ++i) {
+        changed[i] = 0;
+    }
+    changed[999] ^= 1;
+
+    auto longer = changed;
+    longer.resize(1100, 0x55);
+    auto shorter = changed;
+    shorter.resize(333);
+
+    std::vector<u8> unchanged_delta;
+    encode_delta(base, base, unchanged_delta);
+
+    bool result = check(round_trip(base), "delta of unchanged data");
+    result &= check(unchanged_delta.size() <= 2, "unchanged data has an empty delta");
+    result &= check(round_trip(changed), "delta of changed data");
+    result &= check(round_trip(longer), "delta of longer data");
+    result &= check(round_trip(shorter), "delta of shorter data");
+    result &= check(round_trip({}), "delta of empty data");
+    return result;
+}
+
+bool test_dirty_pages() {
+    auto emulator = make_emulator();
+    const auto base = get_state(*emulator);
+    emulator->m_dirty_pages.clear();
+    emulator->run_to_next_frame();
+    const auto state = get_state(*emulator);
+
+    std::vector<ByteRange> ranges;
+    detail::get_dirty_snapshot_ranges(*emulator, ranges);
+    std::vector<u8> delta;
+    encode_delta(base, state, delta, ranges);
+    std::vector<u8> decoded;
+    decode_delta(base, delta, decoded);
+
+    // A page entirely within VRAM, which the program never writes
+    const auto vram = offsetof(MachineState, m_ppu) + offsetof(PpuState, m_vram) + DirtyPages::page_size;
+    bool result = check(decoded == state, "delta of dirty pages");
+    result &= check(emulator->m_dirty_pages.is_dirty(offsetof(MachineState, m_wram_fixed)), "written WRAM is dirty");
+    result &= check(!emulator->m_dirty_pages.is_dirty(vram), "unwritten VRAM is clean");
+
+    load_snapshot(*emulator, Snapshot{base, base.size()});
+    result &= check(emulator->m_dirty_pages.is_dirty(vram), "loading a state marks all pages dirty");
+    return result;
+}
+
+bool test_state_file() {
+    const auto filename = (std::filesystem::temp_directory_path() / "bemu_test_state.sav").string();
+    auto emulator = make_emulator();
+    const auto saved = get_state(*emulator);
+    save_state_to_file(*emulator, filename);
+    emulator->run_to_next_frame();
+
+    load_state_from_file(*emulator, filename);
+    bool result = check(get_state(*emulator) == saved, "state file round trip");
+
+    Screen screen{screen_width, screen_height};
+    result &= check(load_screen_from_file(filename, screen) && screen.m_pixels == emulator->get_screen().m_pixels,
+                    "state file screen");
+
+    // Flip a byte near the end, in the data of the last section
+    {
+        std::fstream file{filename, std::ios::in | std::ios::out | std::ios::binary};
+        file.seekg(-10, std::ios::end);
+        const auto byte = static_cast<char>(file.get() ^ 1);
+        file.seekp(-10, std::ios::end);
+        file.put(byte);
+    }
+    emulator->run_to_next_frame();
+    const auto before = get_state(*emulator);
+    try {
+        load_state_from_file(*emulator, filename);
+        result &= check(false, "corrupt state file is rejected");
+    } catch (const std::runtime_error &) {
+        result &= check(get_state(*emulator) == before, "corrupt state file leaves the state unchanged");
+    }
+
+    std::filesystem::remove(filename);
+    return result;
+}
+
+bool test_unversioned_state_file() {
+    const auto filename = (std::filesystem::temp_directory_path() / "bemu_test_unversioned.sav").string();
+    auto emulator =
+        std::make_unique<Emulator>(make_banked_cartridge(CartridgeType::MBC3_TIMER_RAM_BATTERY, make_program()));
+    for (size_t i = 0; i < 10; ++i) {
+        emulator->run_to_next_frame();
+    }
+
+    // Files without a header hold the stream of Emulator::serialize() from before the clock was saved
+    std::vector<u8> stream;
+    auto buffer = detail::SnapshotOutputBuffer{stream};
+    auto archive = StateOutputArchive{buffer};
+    emulator->serialize_without_rtc(archive);
+    stream.resize(buffer.m_index);
+    write_file_atomically(filename, stream);
+
+    const auto saved = emulator->m_state;
+    emulator->run_to_next_frame();
+    load_state_from_file(*emulator, filename);
+    const auto result = check(std::memcmp(&emulator->m_state, &saved, sizeof(MachineState)) == 0,
+                              "unversioned state file of a cartridge with a clock");
+
+    std::filesystem::remove(filename);
+    return result;
+}
+
+bool test_state_file_writer() {
+    const auto filename = (std::filesystem::temp_directory_path() / "bemu_test_async_state.sav").string();
+    auto emulator = make_emulator();
+    const auto saved = get_state(*emulator);
+
+    StateFileWriter writer;
+    bool result = check(writer.save(*emulator, filename), "state file writer accepts a save");
+    emulator->run_to_next_frame();  // Does not affect the captured state
+    result &= check(writer.wait().succeeded(), "state file writer succeeds");
+    load_state_from_file(*emulator, filename);
+    result &= check(get_state(*emulator) == saved, "state file writer saves the captured state");
+
+    result &= check(writer.save(*emulator, "/nonexistent/bemu.sav") && !writer.wait().succeeded(),
+                    "state file writer reports errors");
+
+    std::filesystem::remove(filename);
+    return result;
+}
+
+bool test_hibernate() {
+    auto emulator = make_emulator();
+    const auto path = get_hibernation_path(std::filesystem::temp_directory_path(), emulator->m_cartridge->header());
+    std::filesystem::remove(path);
+    bool result = check(!resume_from_hibernation(*emulator, path), "nothing to resume without hibernating");
+
+    const auto saved = get_state(*emulator);
+    hibernate(*emulator, path);
+    emulator->run_to_next_frame();
+    result &= check(resume_from_hibernation(*emulator, path) && get_state(*emulator) == saved,
+                    "resume hibernated state");
+
+    std::filesystem::remove(path);
+    return result;
+}
+
+bool test_battery_save() {
+    const auto filename = (std::filesystem::temp_directory_path() / "bemu_test_battery.sav").string();
+    std::filesystem::remove(filename);
+    auto read_file_byte = [&](const std::streamoff offset) {
+        std::ifstream file{filename, std::ios::binary};
+        file.seekg(offset);
+        return file.get();
+    };
+
+    bool result = true;
+    {
+        auto cartridge = Cartridge::from_program_code({});
+        BatterySave battery{*cartridge, filename};
+        cartridge->write(0xA123, 0x42);
+        battery.flush();
+        result &= check(read_file_byte(0x123) == 0x42, "battery save is written on flush");
+    }
+
+    auto cartridge = Cartridge::from_program_code({});
+    BatterySave battery{*cartridge, filename};
+    result &= check(cartridge->read(0xA123) == 0x42, "battery save is loaded");
+
+    // The battery save maps the RAM at its size, so a state with another size must not resize it
+    std::vector<u8> state;
+    auto output_buffer = detail::SnapshotOutputBuffer{state};
+    auto output = StateOutputArchive{output_buffer};
+    output(u8{0});  // RAM bank number
+    output(std::vector<u8>(cartridge->get_ram().size() / 2));
+    auto input_buffer = detail::SpanInputBuffer{std::span{state}.first(output_buffer.m_index)};
+    auto input = StateInputArchive{input_buffer};
+    bool rejected = false;
+    try {
+        cartridge->serialize(input);
+    } catch (const std::runtime_error &) {
+        rejected = true;
+    }
+    result &= check(rejected && cartridge->read(0xA123) == 0x42, "state with another RAM size is rejected");
+
+    std::filesystem::remove(filename);
+    return result;
+}
+
+bool test_rewind() {
+    auto emulator = make_emulator();
+    Rewind<Emulator> rewind{*emulator, 256 * 1024 * 1024, 100, 4};
+
+    // Spans several buckets, each with a full state followed by diffs
+    std::vector<std::vector<u8>> states;
+    for (size_t i = 0; i < 10; ++i) {
+        states.push_back(get_state(*emulator));
+        rewind.push_state();
+        emulator->run_to_next_frame();
+    }
+
+    bool result = true;
+    while (!states.empty()) {
+        result &= check(rewind.pop_state(), "rewind has a state");
+        result &= check(get_state(*emulator) == states.back(), "rewind restores the state");
+        states.pop_back();
+    }
+    result &= check(!rewind.pop_state(), "rewind is empty");
+    return result;
+}
+
+bool test_rewind_eviction() {
+    auto emulator = make_emulator();
+    Rewind<Emulator> rewind{*emulator, 64 * 1024, 100, 4, 100};
+    rewind.set_retention({});
+
+    // Only the newest few buckets fit, so the storage wraps around many times. All are kept in the hot window.
+    std::vector<std::vector<u8>> states;
+    for (size_t i = 0; i < 60; ++i) {
+        states.push_back(get_state(*emulator));
+        rewind.push_state();
+        emulator->run_to_next_frame();
+    }
+
+    bool result = check(rewind.get_used_bytes() <= rewind.get_max_bytes(), "rewind stays within budget");
+    result &= check(rewind.get_num_states() < states.size(), "rewind evicts old states");
+    result &= check(rewind.get_num_states() % 4 == 0, "rewind evicts whole buckets");
+
+    while (rewind.pop_state()) {
+        result &= check(get_state(*emulator) == states.back(), "rewind restores the state after eviction");
+        states.pop_back();
+    }
+    result &= check(rewind.get_used_bytes() == 0, "rewind accounts all bytes");
+    return result;
+}
+
+bool test_lz() {
+    const auto round_trip = [](const std::vector<u8>& data) {
+        std::vector<u8> compressed;
+        lz_compress(data, compressed);
+        std::vector<u8> decompressed(data.size());
+        lz_decompress(compressed, decompressed);
+        return decompressed == data;
+    };
+
+    std::vector<u8> noise(100'000);
+    u32 seed = 1;
+    for (auto& byte : noise) {
+        seed = seed * 1664525 + 1013904223;
+        byte = static_cast<u8>(seed >> 24);
+    }
+    std::vector<u8> repeated(100'000, 0x42);
+    for (size_t i = 0; i < repeated.size(); i += 1000) {
+        repeated[i] = static_cast<u8>(i);
+    }
+
+    std::vector<u8> compressed;
+    lz_compress(repeated, compressed);
+
+    bool result = check(round_trip(noise), "LZ of incompressible data");
+    result &= check(round_trip(repeated), "LZ of repetitive data");
+    result &= check(compressed.size() < repeated.size() / 10, "LZ compresses repetitive data");
+    result &= check(round_trip({}), "LZ of empty data");
+    result &= check(round_trip({1, 2, 3}), "LZ of short data");
+    return result;
+}
+
+bool test_page_store() {
+    std::vector<u8> a(1000);
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = static_cast<u8>(i * 7 + i / PageStore::page_size);  // No two pages alike
+    }
+    auto b = a;
+    b[300] ^= 1;
+
+    PageStore store;
+    std::vector<PageStore::PageId> ids_a;
+    std::vector<PageStore::PageId> ids_b;
+    store.store(a, ids_a);
+    store.store(b, ids_b);
+
+    std::vector<u8> loaded;
+    store.load(ids_b, b.size(), loaded);
+    bool result = check(loaded == b, "page store round trip");
+    result &= check(store.get_num_pages() == ids_a.size() + 1, "page store shares identical pages");
+
+    store.release(ids_a);
+    result &= check(store.get_num_pages() == ids_b.size(), "page store frees unused pages");
+    store.load(ids_b, b.size(), loaded);
+    result &= check(loaded == b, "page store keeps shared pages");
+    store.release(ids_b);
+    result &= check(store.get_num_pages() == 0, "page store frees all pages");
+    return result;
+}
+
+bool test_compressed_rewind() {
+    auto emulator = make_emulator();
+    Rewind<Emulator> rewind{*emulator, 256 * 1024 * 1024, 100, 4, 1};
+    rewind.set_retention({});
+
+    // All but the newest bucket are compressed on the worker thread
+    std::vector<std::vector<u8>> states;
+    const auto push = [&](const size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            states.push_back(get_state(*emulator));
+            rewind.push_state();
+            emulator->run_to_next_frame();
+        }
+    };
+
+    bool result = true;
+    const auto pop = [&](const size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            result &= check(rewind.pop_state(), "compressed rewind has a state");
+            result &= check(get_state(*emulator) == states.back(), "compressed rewind restores the state");
+            states.pop_back();
+        }
+    };
+
+    // Rewind into the compressed history, play on, then rewind through everything
+    push(30);
+    pop(15);
+    push(10);
+    result &= check(rewind.get_num_states() == states.size(), "compressed rewind counts all states");
+    pop(states.size());
+    result &= check(!rewind.pop_state(), "compressed rewind is empty");
+    result &= check(rewind.get_used_bytes() == 0, "compressed rewind accounts all bytes");
+    return result;
+}
+
+bool test_rewind_thinning() {
+    auto emulator = make_emulator();
+    Rewind<Emulator> rewind{*emulator, 256 * 1024 * 1024, 100, 4, 1};
+    rewind.set_retention({{0.0, 2}, {0.25, 4}, {0.5, 8}});
+
+    // About one second of frames, so the oldest buckets reach every tier
+    std::vector<std::vector<u8>> states;
+    for (size_t i = 0; i < 60; ++i) {
+        states.push_back(get_state(*emulator));
+        rewind.push_state();
+        emulator->run_to_next_frame();
+    }
+    bool result = check(rewind.get_num_states() < states.size() / 2, "rewind thins out old states");
+
+    // Every popped state is one of the captured states, in order
+    while (rewind.pop_state()) {
+        const auto state = get_state(*emulator);
+        while (!states.empty() && states.back() != state) {
+            states.pop_back();
+        }
+        result &= check(!states.empty(), "thinned rewind restores a captured state");
+    }
+    result &= check(rewind.get_used_bytes() == 0, "thinned rewind accounts all bytes");
+
+    rewind.set_capture_interval(3);
+    for (size_t i = 0; i < 9; ++i) {
+        rewind.push_state();
+        emulator->run_to_next_frame();
+    }
+    result &= check(rewind.get_num_states() == 3, "rewind captures every Nth frame");
+    return result;
+}
+
+bool test_rewind_seek() {
+    auto emulator = make_emulator();
+    Rewind<Emulator> rewind{*emulator, 256 * 1024 * 1024, 100, 4, 1};
+    rewind.set_retention({});
+
+    // Most states are in compressed buckets
+    const auto start = std::chrono::system_clock::time_point{};
+    std::vector<std::vector<u8>> states;
+    std::vector<u64> ticks;
+    std::vector<Screen> screens;
+    for (size_t i = 0; i < 30; ++i) {
+        // Distinct screenshots
+        emulator->get_screen().set_pixel(static_cast<int>(i), static_cast<int>(i), static_cast<u8>(i % 3 + 1));
+        screens.push_back(emulator->get_screen());
+        states.push_back(get_state(*emulator));
+        ticks.push_back(emulator->get_tick_count());
+        rewind.push_state(start + std::chrono::seconds{i});
+        emulator->run_to_next_frame();
+    }
+
+    bool result = check(rewind.seek_to_ticks(ticks[5]) && get_state(*emulator) == states[5], "seek to ticks");
+    result &= check(rewind.seek_to_ticks(ticks[25] + 1) && get_state(*emulator) == states[25], "seek forward again");
+    result &= check(rewind.seek_to_time(start + std::chrono::milliseconds{7500}) && get_state(*emulator) == states[7],
+                    "seek to wall clock time");
+    result &= check(rewind.seek_to_ticks(0) && get_state(*emulator) == states[0], "seek before the first state");
+    result &= check(rewind.get_num_states() == states.size(), "seeking keeps all states");
+
+    Screen screen = emulator->get_screen();
+    result &= check(rewind.get_screenshot(ticks[6], screen) && screen.m_pixels == screens[6].m_pixels,
+                    "screenshot of a compressed state");
+    result &= check(rewind.get_screenshot(ticks[29], screen) && screen.m_pixels == screens[29].m_pixels,
+                    "screenshot of a recent state");
+
+    // Rewinding from a seek continues before the loaded state
+    rewind.seek_to_ticks(ticks[12]);
+    result &= check(rewind.pop_state() && get_state(*emulator) == states[11], "pop after seek");
+    result &= check(rewind.get_num_states() == 11, "pop after seek discards the newer states");
+
+    // Playing on from a seek drops the states after the loaded one
+    rewind.seek_to_ticks(ticks[8]);
+    emulator->run_to_next_frame();
+    rewind.push_state();
+    result &= check(rewind.get_num_states() == 10, "push after seek discards the newer states");
+
+    rewind.set_store_screenshots(false);
+    emulator->run_to_next_frame();
+    rewind.push_state();
+    result &= check(!rewind.get_screenshot(emulator->get_tick_count(), screen), "states without screenshots");
+    return result;
+}
+
+bool test_run_ahead() {
+    auto reference = make_emulator();
+    auto emulator = make_emulator();
+
+    RunAhead<Emulator> run_ahead{*emulator, 2};
+    run_ahead.run_frame();
+
+    reference->run_to_next_frame();
+    bool result = check(get_state(*emulator) == get_state(*reference), "run-ahead leaves the real state untouched");
+
+    reference->run_to_next_frame();
+    reference->run_to_next_frame();
+    result &= check(run_ahead.get_screen().m_pixels == reference->get_screen().m_pixels,
+                    "run-ahead displays the future frame");
+    return result;
+}
+
+bool test_run_ahead_dirty_pages() {
+    auto emulator = make_emulator();
+    RunAhead<Emulator> run_ahead{*emulator, 2};
+    Rewind<Emulator> rewind{*emulator, 64 * 1024 * 1024, 100, 4};
+    for (size_t i = 0; i < 4; ++i) {
+        run_ahead.run_frame();
+        rewind.push_state();
+    }
+
+    // Restoring the state from before the run-ahead frames must not mark every page dirty
+    emulator->m_dirty_pages.clear();
+    emulator->m_cartridge->get_ram_dirty_pages().clear();
+    run_ahead.run_frame();
+
+    size_t dirty_size = 0;
+    emulator->m_dirty_pages.for_each_dirty_range([&](size_t, const size_t size) { dirty_size += size; });
+    size_t dirty_ram_size = 0;
+    emulator->m_cartridge->get_ram_dirty_pages().for_each_dirty_range(
+        [&](size_t, const size_t size) { dirty_ram_size += size; });
+    const auto vram_offset = offsetof(MachineState, m_ppu) + offsetof(PpuState, m_vram) + 0x1000;  // Not written
+    return check(dirty_size < sizeof(MachineState) / 4 && !emulator->m_dirty_pages.is_dirty(vram_offset) &&
+                     dirty_ram_size == 0,
+                 "run-ahead only marks the pages written");
+}
+
+bool test_clone() {
+    auto emulator = make_emulator();
+    auto clone = emulator->clone();
+    bool result = check(get_state(*clone) == get_state(*emulator), "clone has the same state");
+
+    emulator->run_to_next_frame();
+    clone->run_to_next_frame();
+    result &= check(get_state(*clone) == get_state(*emulator), "clone runs independently and deterministically");
+    result &= check(clone->m_cartridge->shares_rom_with(*emulator->m_cartridge), "clone shares the ROM");
+
+    emulator->run_to_next_frame();
+    emulator->clone_into(*clone);
+    result &= check(get_state(*clone) == get_state(*emulator), "clone_into copies the state");
+
+    auto other = make_emulator();
+    try {
+        emulator->clone_into(*other);
+        result &= check(false, "clone_into rejects a different ROM");
+    } catch (const std::invalid_argument &) {
+    }
+    return result;
+}
+
+bool test_shared_rom_file() {
+    const auto filename = (std::filesystem::temp_directory_path() / "bemu_test_rom.gb").string();
+    {
+        std::vector<char> rom(0x8000, 0x00);  // ROM_ONLY, 32 KiB, no RAM
+        rom[0x4321] = 0x42;
+        std::ofstream{filename, std::ios::binary}.write(rom.data(), static_cast<std::streamsize>(rom.size()));
+    }
+
+    bool result = true;
+    {
+        const auto first = Cartridge::from_file(filename);
+        const auto second = Cartridge::from_file(filename);
+        result &= check(first->shares_rom_with(*second), "cartridges of the same file share the ROM");
+        result &= check(second->read(0x4321) == 0x42, "ROM is read from the file");
+    }
+
+    std::filesystem::remove(filename);  // After unmapping, which Windows requires
+    return result;
+}
+
+bool test_speculative_run_ahead() {
+    auto reference = make_emulator();
+    auto emulator = make_emulator();
+
+    RunAhead<Emulator> serial{*reference, 2};
+    SpeculativeRunAhead<Emulator> speculative{*emulator, 2, 2};
+
+    bool result = true;
+    for (const u8 buttons : {0x00, 0x00, 0x01, 0x01, 0x81, 0x00}) {
+        reference->m_external->set_buttons(buttons);
+        serial.run_frame();
+        speculative.run_frame(buttons);
+
+        result &= check(get_state(*emulator) == get_state(*reference), "speculation matches serial state");
+        result &= check(speculative.get_screen().m_pixels == serial.get_screen().m_pixels,
+                        "speculation matches serial screen");
+    }
+    result &= check(speculative.get_stats().m_hits > 0, "speculation is used");
+    return result;
+}
+}  // namespace
+
+int main() {
+    bool result = test_snapshot_round_trip();
+    result &= test_serialize_matches_snapshot();
+    result &= test_delta();
+    result &= test_dirty_pages();
+    result &= test_state_file();
+    result &= test_unversioned_state_file();
+    result &= test_state_file_writer();
+    result &= test_hibernate();
+    result &= test_battery_save();
+    result &= test_shared_rom_file();
+    result &= test_rewind();
+    result &= test_rewind_eviction();
+    result &= test_lz();
+    result &= test_page_store();
+    result &= test_compressed_rewind();
+    result &= test_rewind_thinning();
+    result &= test_rewind_seek();
+    result &= test_run_ahead();
+    result &= test_run_ahead_dirty_pages();
+    result &= test_clone();
+    result &= test_speculative_run_ahead();
+
+    return result ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <bemu/gb/cartridge.hpp>
+#include <bemu/gb/emulator.hpp>
+#include <bemu/save/snapshot.hpp>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bemu::gb::test {
+/// Endlessly fills WRAM (0xC000 - 0xDFFF) with an incrementing counter
+inline std::vector<u8> make_program() {
+    return {
+        0x21, 0x00, 0xC0,  // LD HL, 0xC000
+        0x04,              // INC B
+        0x78,              // LD A, B
+        0x22,              // LD (HL+), A
+        0x7C,              // LD A, H
+        0xE6, 0x1F,        // AND 0x1F
+        0xF6, 0xC0,        // OR 0xC0
+        0x67,              // LD H, A
+        0x18, 0xF5,        // JR -11
+    };
+}
+
+inline std::unique_ptr<Emulator> make_emulator(const size_t frames = 10) {
+    auto emulator = std::make_unique<Emulator>(Cartridge::from_program_code(make_program()));
+    for (size_t i = 0; i < frames; ++i) {
+        emulator->run_to_next_frame();
+    }
+    return emulator;
+}
+
+/// Cartridge with the mapper of type, 128 KiB of ROM where each bank but the first is filled with its number, and
+/// 32 KiB of RAM. Runs program, as Cartridge::from_program_code() does.
+inline std::unique_ptr<Cartridge> make_banked_cartridge(const CartridgeType type, const std::vector<u8> &program = {}) {
+    auto rom = std::make_shared<std::vector<u8>>(8 * 0x4000);
+    for (size_t i = 0x4000; i < rom->size(); ++i) {
+        (*rom)[i] = static_cast<u8>(i / 0x4000);
+    }
+
+    auto header = Cartridge::from_program_code({})->header();
+    header.cartridge_type = type;
+    header.rom_size = RomSizeType::Kb128_bank8;
+    header.ram_size = RamSizeType::Kb32;
+    reinterpret_cast<CartridgeHeader &>(rom->at(0x0100)) = header;
+    std::ranges::copy(program, rom->begin() + 0x0150);
+
+    const std::span<const u8> image = *rom;
+    return std::make_unique<Cartridge>(image, std::move(rom));
+}
+
+inline std::vector<u8> get_state(Emulator &emulator) {
+    Snapshot snapshot;
+    save_snapshot(emulator, snapshot);
+    return {snapshot.data().begin(), snapshot.data().end()};
+}
+
+inline bool check(const bool condition, const std::string &name) {
+    if (!condition) {
+        std::cout << fmt::format("ERROR: {}\n", name);
+    }
+    return condition;
+}
+}  // namespace bemu::gb::test